@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// A monotonic arena: allocations are carved one after another out of large
+// blocks and never freed one at a time; every block goes at once when the
+// arena does. Blocks at least double the arena each time it grows, so n
+// bytes take O(log n) allocations. Blocks are not zeroed, so the OS only
+// backs the parts that get written.
+//
+// Only objects that need no destructor may live here. Not thread-safe.
+class Arena {
+  // Member Variables
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+  char*  m_next  = nullptr;
+  size_t m_left  = 0;
+  size_t m_bytes = 0;  // In all blocks
+  size_t m_first;
+
+public:
+  explicit Arena(size_t first = 64 * 1024) : m_first(first) {}
+
+  Arena(const Arena& other) = delete;
+  Arena& operator = (const Arena& other) = delete;
+
+  void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+    size_t skip = (align - reinterpret_cast<uintptr_t>(m_next) % align) % align;
+    if (m_next == nullptr || skip + size > m_left) {
+      size_t block = std::max({size + align, m_first, m_bytes});
+      m_blocks.emplace_back(new char[block]);
+      m_next = m_blocks.back().get();
+      m_left = block;
+      m_bytes += block;
+      skip = (align - reinterpret_cast<uintptr_t>(m_next) % align) % align;
+    }
+
+    char* result = m_next + skip;
+    m_next += skip + size;
+    m_left -= skip + size;
+    return result;
+  }
+
+  // Room for count Ts, not yet constructed.
+  template <typename T>
+  T* allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "The arena never runs destructors");
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Getter Functions
+  size_t bytes() const { return m_bytes; }
+  size_t blocks() const { return m_blocks.size(); }
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "ChangeLog.h"
+// ChangeLog Member Functions
+#include "family.h"
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // Split a line at its tabs.
+    std::vector<std::string_view> fields(std::string_view line) {
+        std::vector<std::string_view> result;
+        size_t start = 0;
+        for (size_t tab = line.find('\t'); tab != std::string_view::npos; tab = line.find('\t', start)) {
+            result.push_back(line.substr(start, tab - start));
+            start = tab + 1;
+        }
+        result.push_back(line.substr(start));
+        return result;
+    }
+
+    Person* lookup(const GenePool& pool, std::string_view name) {
+        Person* person = pool.find(name);
+        if (person == nullptr) {
+            throw std::runtime_error("No such person: " + std::string(name));
+        }
+        return person;
+    }
+
+    Person* parent(const GenePool& pool, std::string_view name) {
+        return name == "???" ? nullptr : lookup(pool, name);
+    }
+}
+
+// Writing
+void ChangeLog::write(const std::string& line) {
+    if (!m_out.is_open()) {
+        m_out.open(m_path, std::ios::out | std::ios::app | std::ios::binary);
+    }
+    m_out << line << '\n';
+    m_out.flush();
+    if (!m_out) {
+        throw std::runtime_error("Cannot write change log: " + m_path);
+    }
+}
+
+void ChangeLog::add(std::string_view name, Gender gender, std::string_view mother, std::string_view father) {
+    write("add\t" + std::string(name) + '\t' + (gender == Gender::MALE ? "male" : "female") + '\t'
+        + std::string(mother) + '\t' + std::string(father));
+}
+
+void ChangeLog::parents(std::string_view name, std::string_view mother, std::string_view father) {
+    write("parents\t" + std::string(name) + '\t' + std::string(mother) + '\t' + std::string(father));
+}
+
+void ChangeLog::remove(std::string_view name) {
+    write("remove\t" + std::string(name));
+}
+
+// Reading
+size_t ChangeLog::follow(GenePool& pool) {
+    std::ifstream in(m_path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) return 0;
+
+    in.seekg(0, std::ios::end);
+    std::streamoff end = in.tellg();
+    if (end <= static_cast<std::streamoff>(m_applied)) return 0;
+
+    std::string text(static_cast<size_t>(end - m_applied), '\0');
+    in.seekg(static_cast<std::streamoff>(m_applied));
+    in.read(&text[0], static_cast<std::streamsize>(text.size()));
+    text.resize(static_cast<size_t>(in.gcount()));
+
+    size_t used = 0;
+    size_t edits = 0;
+    try {
+        apply(pool, text.data(), text.size(), used, edits);
+    }
+    catch (...) {
+        m_applied += text.find('\n', used) + 1;
+        m_edits += edits;
+        throw;
+    }
+    m_applied += used;
+    m_edits += edits;
+    return edits;
+}
+
+void ChangeLog::apply(GenePool& pool, const char* data, size_t size, size_t& used, size_t& edits) {
+    used = 0;
+    edits = 0;
+
+    std::string_view text(data, size);
+    for (size_t newline = text.find('\n'); newline != std::string_view::npos; newline = text.find('\n', used)) {
+        std::string_view line = text.substr(used, newline - used);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        if (!line.empty() && line[0] != '#') {
+            std::vector<std::string_view> parts = fields(line);
+            if (parts[0] == "add" && parts.size() == 5) {
+                Gender gender = parts[2] == "male" ? Gender::MALE : Gender::FEMALE;
+                pool.add(parts[1], gender, parent(pool, parts[3]), parent(pool, parts[4]));
+            }
+            else if (parts[0] == "parents" && parts.size() == 4) {
+                pool.setParents(lookup(pool, parts[1]), parent(pool, parts[2]), parent(pool, parts[3]));
+            }
+            else if (parts[0] == "remove" && parts.size() == 2) {
+                pool.remove(lookup(pool, parts[1]));
+            }
+            else {
+                throw std::runtime_error("Bad change log line: " + std::string(line));
+            }
+            ++edits;
+        }
+        used = newline + 1;
+    }
+}
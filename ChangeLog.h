@@ -0,0 +1,57 @@
+#ifndef CHANGELOG_H
+#define CHANGELOG_H
+
+#include "Roles.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+class GenePool;
+
+// An append-only file of edits to a pool, one TSV line each:
+//
+//   add      <name>  <gender>  <mother>  <father>
+//   parents  <name>  <mother>  <father>
+//   remove   <name>
+//
+// Names are looked up when a line is applied, as rows of an IN_ORDER data
+// file are, and ??? is an unknown parent. Writers append whole lines and
+// flush them; a running process calls follow() now and then to apply
+// whatever has been appended since, instead of reloading the data file.
+// Blank lines and lines starting with '#' are skipped.
+class ChangeLog {
+  // Member Variables
+  std::string   m_path;
+  std::ofstream m_out;          // Opened on the first write
+  uint64_t      m_applied = 0;  // Bytes of the file follow() has applied
+  size_t        m_edits   = 0;  // Edits in them
+
+  void write(const std::string& line);
+
+public:
+  explicit ChangeLog(std::string path) : m_path(std::move(path)) {}
+
+  // Append one edit.
+  void add(std::string_view name, Gender gender, std::string_view mother, std::string_view father);
+  void parents(std::string_view name, std::string_view mother, std::string_view father);
+  void remove(std::string_view name);
+
+  // Apply every whole line appended since the last call, returning how many
+  // edits that was. A missing file has no edits yet. Throws
+  // std::runtime_error for a line that cannot be applied; the lines before
+  // it stay applied, and the next call carries on after it.
+  size_t follow(GenePool& pool);
+
+  // Edits applied by follow() so far.
+  size_t edits() const { return m_edits; }
+
+  // Apply the whole lines at the start of [data, data + size): everything
+  // up to the last newline. Sets used to the bytes applied and edits to the
+  // edits among them, both up to date even if this throws.
+  static void apply(GenePool& pool, const char* data, size_t size, size_t& used, size_t& edits);
+};
+
+#endif
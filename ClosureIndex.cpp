@@ -0,0 +1,222 @@
+#include "ClosureIndex.h"
+// ClosureIndex Member Functions
+#include "Traversal.h"
+#include <algorithm>
+#include <array>
+
+/*
+Number everyone in DFS preorder, then compute each person's reachable
+intervals in DFS postorder, when all of their successors are finished:
+their own spanning subtree [pre, last] plus the merged intervals of every
+successor. A person with more than limit intervals, or with an unlabeled
+successor, gets none. Successors that are still on the stack (only possible
+if the data contains a cycle) are skipped rather than read half-built.
+*/
+template <typename Successors>
+void ClosureIndex::Labels::build(size_t count, bool forward, uint32_t limit, Successors successors) {
+    enum : uint8_t { NEW, OPEN, DONE };
+    struct Frame {
+        PersonID id;
+        uint32_t next;
+    };
+
+    std::vector<uint8_t>  state(count, NEW);
+    std::vector<uint32_t> begins(count);
+    std::vector<uint32_t> ends(count);
+    std::vector<Interval> scratch;
+    std::vector<Interval> unordered;
+    std::vector<Frame>    stack;
+
+    pre.assign(count, 0);
+    order.resize(count);
+    uint32_t counter = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        PersonID root = static_cast<PersonID>(forward ? i : count - 1 - i);
+        if (state[root] != NEW) continue;
+
+        state[root] = OPEN;
+        pre[root] = counter;
+        order[counter++] = root;
+        stack.push_back(Frame{root, 0});
+
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            auto next = successors(frame.id);
+            if (frame.next < next.size()) {
+                PersonID id = next[frame.next++];
+                if (id != NO_PERSON && state[id] == NEW) {
+                    state[id] = OPEN;
+                    pre[id] = counter;
+                    order[counter++] = id;
+                    stack.push_back(Frame{id, 0});
+                }
+                continue;
+            }
+
+            PersonID id = frame.id;
+            stack.pop_back();
+
+            state[id] = DONE;
+            begins[id] = ends[id] = static_cast<uint32_t>(unordered.size());
+
+            bool complete = true;
+            scratch.clear();
+            scratch.push_back(Interval{pre[id], counter - 1});
+            for (PersonID succ : next) {
+                if (succ == NO_PERSON || succ == id || state[succ] != DONE) continue;
+                if (begins[succ] == ends[succ]) complete = false;
+                scratch.insert(scratch.end(), unordered.begin() + begins[succ], unordered.begin() + ends[succ]);
+            }
+            if (!complete) continue;
+
+            std::sort(scratch.begin(), scratch.end(), [](const Interval& a, const Interval& b) {
+                return a.first < b.first;
+            });
+
+            unordered.push_back(scratch[0]);
+            for (size_t k = 1; k < scratch.size(); ++k) {
+                Interval& last = unordered.back();
+                if (scratch[k].first <= last.last + 1) {
+                    last.last = std::max(last.last, scratch[k].last);
+                }
+                else {
+                    unordered.push_back(scratch[k]);
+                }
+            }
+
+            if (unordered.size() - begins[id] > limit) {
+                unordered.resize(begins[id]);
+            }
+            ends[id] = static_cast<uint32_t>(unordered.size());
+        }
+    }
+
+    // Lay the intervals out by ID.
+    offsets.assign(count + 1, 0);
+    for (size_t id = 0; id < count; ++id) {
+        offsets[id + 1] = offsets[id] + (ends[id] - begins[id]);
+    }
+    intervals.resize(offsets[count]);
+    for (size_t id = 0; id < count; ++id) {
+        std::copy(unordered.begin() + begins[id], unordered.begin() + ends[id], intervals.begin() + offsets[id]);
+    }
+}
+
+// Is to in the closure of from (including from itself)?
+bool ClosureIndex::Labels::reaches(PersonID from, PersonID to) const {
+    uint32_t target = pre[to];
+    const Interval* first = intervals.data() + offsets[from];
+    const Interval* last  = intervals.data() + offsets[from + 1];
+
+    // Tree-like closures are a single interval: answer without searching.
+    if (last - first == 1) {
+        return first->first <= target && target <= first->last;
+    }
+
+    const Interval* it = std::upper_bound(first, last, target, [](uint32_t value, const Interval& interval) {
+        return value < interval.first;
+    });
+    return it != first && target <= (it - 1)->last;
+}
+
+void ClosureIndex::Labels::enumerate(PersonID from, PersonID skip, std::vector<PersonID>& out) const {
+    for (uint32_t k = offsets[from]; k < offsets[from + 1]; ++k) {
+        for (uint32_t p = intervals[k].first; p <= intervals[k].last; ++p) {
+            if (order[p] != skip) {
+                out.push_back(order[p]);
+            }
+        }
+    }
+}
+
+size_t ClosureIndex::Labels::bytes() const {
+    return pre.capacity() * sizeof(uint32_t) + order.capacity() * sizeof(PersonID) +
+           offsets.capacity() * sizeof(uint32_t) + intervals.capacity() * sizeof(Interval);
+}
+
+// Constructor
+ClosureIndex::ClosureIndex(const PersonStore& store, uint32_t limit)
+    : m_store(&store) {
+    // Parents come before their children in a loaded file, so walk child
+    // links from the lowest IDs and parent links from the highest.
+    m_down.build(store.size(), true, limit, [&](PersonID id) {
+        return store.children(id);
+    });
+    m_up.build(store.size(), false, limit, [&](PersonID id) {
+        return std::array<PersonID, 2>{{store.mother(id), store.father(id)}};
+    });
+}
+
+// Every closure includes the person themself.
+size_t ClosureIndex::Labels::count(PersonID from) const {
+    size_t result = 0;
+    for (uint32_t k = offsets[from]; k < offsets[from + 1]; ++k) {
+        result += intervals[k].last - intervals[k].first + 1;
+    }
+    return result - 1;
+}
+
+/*
+Probe a's descendant intervals, or failing that b's ancestor intervals.
+If neither is labeled, walk down from a, answering from the labels of
+the first labeled people reached instead of walking past them.
+*/
+bool ClosureIndex::is_ancestor(PersonID a, PersonID b) const {
+    if (a == b) return false;
+    if (m_down.labeled(a)) return m_down.reaches(a, b);
+    if (m_up.labeled(b)) return m_up.reaches(b, a);
+
+    return Traversal::local().search(*m_store, a,
+        [&](PersonID id) { return id == b || (m_down.labeled(id) && m_down.reaches(id, b)); },
+        [&](PersonID id) { return m_down.labeled(id); });
+}
+
+bool ClosureIndex::ancestors(PersonID id, PMod pmod, std::vector<PersonID>& out) const {
+    if (pmod == PMod::ANY) {
+        if (!m_up.labeled(id)) return false;
+        m_up.enumerate(id, id, out);
+        return true;
+    }
+
+    PersonID parent = (pmod == PMod::MATERNAL) ? m_store->mother(id) : m_store->father(id);
+    if (parent == NO_PERSON) return true;
+    if (!m_up.labeled(parent)) return false;
+    m_up.enumerate(parent, NO_PERSON, out);
+    return true;
+}
+
+bool ClosureIndex::descendants(PersonID id, std::vector<PersonID>& out) const {
+    if (!m_down.labeled(id)) return false;
+    m_down.enumerate(id, id, out);
+    return true;
+}
+
+bool ClosureIndex::count_ancestors(PersonID id, size_t& count) const {
+    if (!m_up.labeled(id)) return false;
+    count = m_up.count(id);
+    return true;
+}
+
+bool ClosureIndex::count_descendants(PersonID id, size_t& count) const {
+    if (!m_down.labeled(id)) return false;
+    count = m_down.count(id);
+    return true;
+}
+
+size_t ClosureIndex::intervals() const {
+    return m_down.intervals.size() + m_up.intervals.size();
+}
+
+double ClosureIndex::coverage() const {
+    size_t count = m_down.pre.size();
+    size_t labeled = 0;
+    for (PersonID id = 0; id < count; ++id) {
+        labeled += m_down.labeled(id) + m_up.labeled(id);
+    }
+    return count ? labeled / (2.0 * count) : 1.0;
+}
+
+size_t ClosureIndex::bytes() const {
+    return m_down.bytes() + m_up.bytes();
+}
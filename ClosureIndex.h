@@ -0,0 +1,83 @@
+#ifndef CLOSUREINDEX_H
+#define CLOSUREINDEX_H
+
+#include "PersonStore.h"
+#include "Roles.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Precomputed ancestor/descendant reachability for a PersonStore.
+//
+// People are numbered in DFS preorder over a spanning forest of the graph, so
+// everyone in a spanning subtree has a contiguous range of numbers. Each
+// person keeps the merged list of preorder intervals covering everything they
+// can reach: one interval where the family is tree-like, plus one per extra
+// branch reached through a second parent (the DAG merges). The same labeling
+// is built twice: over child links (descendants) and over parent links
+// (ancestors).
+//
+// Heavily interbred pedigrees fragment into many intervals, so each person
+// keeps at most a fixed number. People over that limit (and everyone who
+// reaches them) are left unlabeled; queries about them fall back to a walk
+// that stops at the first labeled people it meets.
+//
+// The index is a snapshot: rebuild it if the store changes.
+class ClosureIndex {
+public:
+  struct Interval {
+    uint32_t first;
+    uint32_t last;
+  };
+
+private:
+  struct Labels {
+    std::vector<uint32_t> pre;       // Preorder number of each ID
+    std::vector<PersonID> order;     // ID at each preorder number
+    std::vector<uint32_t> offsets;   // Per-ID ranges into intervals
+    std::vector<Interval> intervals;
+
+    template <typename Successors>
+    void build(size_t count, bool forward, uint32_t limit, Successors successors);
+    bool labeled(PersonID id) const { return offsets[id + 1] > offsets[id]; }
+    bool reaches(PersonID from, PersonID to) const;
+    void enumerate(PersonID from, PersonID skip, std::vector<PersonID>& out) const;
+    size_t count(PersonID from) const;
+    size_t bytes() const;
+  };
+
+  // Member Variables
+  const PersonStore* m_store;
+  Labels m_down;
+  Labels m_up;
+
+public:
+  // Build both labelings, keeping at most limit intervals per person.
+  // O(n + edges) plus the cost of merging intervals.
+  ClosureIndex(const PersonStore& store, uint32_t limit = 16);
+
+  // Is a a (strict) ancestor of b?
+  bool is_ancestor(PersonID a, PersonID b) const;
+
+  // Append everyone in the closure to out, in no particular order.
+  // Returns false (leaving out untouched) if the person is unlabeled.
+  bool ancestors(PersonID id, PMod pmod, std::vector<PersonID>& out) const;
+  bool descendants(PersonID id, std::vector<PersonID>& out) const;
+
+  // Count everyone in the closure without listing them, in time linear in
+  // the person's intervals. Returns false if the person is unlabeled; if it
+  // returns true, is_ancestor() answers about them without a walk.
+  bool count_ancestors(PersonID id, size_t& count) const;
+  bool count_descendants(PersonID id, size_t& count) const;
+
+  // Total intervals stored; equals 2n when every closure is tree-like.
+  size_t intervals() const;
+
+  // Fraction of people whose descendants / ancestors are labeled.
+  double coverage() const;
+
+  // Approximate heap footprint.
+  size_t bytes() const;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// A flat array that either owns its elements or views someone else's, such
+// as a section of a memory-mapped snapshot. Reads go through one pointer
+// either way. Writing to a viewed column first copies it into owned storage.
+template <typename T>
+class Column {
+  // Member Variables
+  std::vector<T> m_owned;
+  const T*       m_data    = nullptr;
+  size_t         m_size    = 0;
+  bool           m_viewing = false;
+
+  void own() {
+    if (m_viewing) {
+      m_owned.assign(m_data, m_data + m_size);
+      m_viewing = false;
+    }
+  }
+
+  void sync() {
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+  }
+
+public:
+  // Read Access
+  const T& operator [] (size_t i) const { return m_data[i]; }
+  const T* data() const { return m_data; }
+  size_t   size() const { return m_size; }
+  bool     viewing() const { return m_viewing; }
+
+  // Point at size elements that outlive the column.
+  void view(const T* data, size_t size) {
+    m_owned = std::vector<T>();
+    m_data = data;
+    m_size = size;
+    m_viewing = true;
+  }
+
+  // Write Access
+  void assign(size_t size, const T& value) { m_viewing = false; m_owned.assign(size, value); sync(); }
+  void assign(std::vector<T> values) { m_viewing = false; m_owned = std::move(values); sync(); }
+  void resize(size_t size, const T& value = T()) { own(); m_owned.resize(size, value); sync(); }
+  void push_back(const T& value) { own(); m_owned.push_back(value); sync(); }
+
+  // Element writes and the raw pointer do not reallocate, so different
+  // threads may write different elements of an owned column at once.
+  void set(size_t i, const T& value) { own(); m_owned[i] = value; }
+  T*   mutable_data() { own(); return m_owned.data(); }
+
+  // Give back spare capacity left by growth (a viewed column has none).
+  void shrink() { if (!m_viewing) { m_owned.shrink_to_fit(); sync(); } }
+
+  // Heap bytes owned by the column (viewed data is not counted).
+  size_t bytes() const { return m_owned.capacity() * sizeof(T); }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "ConcurrentPool.h"
+// ConcurrentPool Member Functions
+#include "ChangeLog.h"
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Constructors
+ConcurrentPool::ConcurrentPool(const char* data, size_t size, LoadMode mode) {
+    m_pools[0].reset(new GenePool(data, size, mode));
+    m_pools[1].reset(new GenePool(data, size, mode));
+    m_current.store(m_pools[0].get());
+}
+
+ConcurrentPool::ConcurrentPool(std::shared_ptr<const MappedFile> snapshot, bool verify) {
+    m_pools[0].reset(new GenePool(snapshot, verify));
+    m_pools[1].reset(new GenePool(snapshot, false));
+    m_current.store(m_pools[0].get());
+}
+
+void ConcurrentPool::enableCache(size_t bytes) {
+    m_pools[0]->enableCache(bytes);
+    m_pools[1]->enableCache(bytes);
+}
+
+/*
+Claim a free slot with the current epoch, then load the published copy.
+Both are sequentially consistent, as are the writer's swap and its scan of
+the slots, so either the writer sees this slot taken or this read sees the
+new copy. Threads start looking at different slots, so they seldom contend.
+*/
+ConcurrentPool::Reader ConcurrentPool::read() const {
+    size_t first = std::hash<std::thread::id>()(std::this_thread::get_id()) % SLOTS;
+    for (size_t i = first;;) {
+        uint64_t expected = 0;
+        if (m_slots[i].epoch.compare_exchange_strong(expected, m_epoch.load())) {
+            return Reader(m_current.load(), &m_slots[i]);
+        }
+        i = (i + 1) % SLOTS;
+        if (i == first) std::this_thread::yield();
+    }
+}
+
+// Writer Functions
+size_t ConcurrentPool::update(std::string_view lines) {
+    std::string text(lines);
+    if (!text.empty() && text.back() != '\n') text += '\n';
+
+    GenePool* current = m_current.load();
+    GenePool* standby = current == m_pools[0].get() ? m_pools[1].get() : m_pools[0].get();
+
+    std::string applied;
+    std::string error;
+    size_t edits = edit(*standby, text, &applied, &error);
+    m_current.store(standby);
+    publish();
+    edit(*current, applied, nullptr, nullptr);
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    return edits;
+}
+
+// Start a new epoch, then wait until no reader is left in an older one
+void ConcurrentPool::publish() {
+    uint64_t epoch = m_epoch.fetch_add(1) + 1;
+    for (Slot& slot : m_slots) {
+        for (;;) {
+            uint64_t seen = slot.epoch.load();
+            if (seen == 0 || seen >= epoch) break;
+            std::this_thread::yield();
+        }
+    }
+}
+
+/*
+Apply the lines, skipping any that fail. The ones that worked are collected
+in applied (if given), so the other copy can make exactly the same edits.
+*/
+size_t ConcurrentPool::edit(GenePool& pool, std::string_view lines, std::string* applied, std::string* error) {
+    size_t total = 0;
+    while (!lines.empty()) {
+        size_t used = 0;
+        size_t edits = 0;
+        try {
+            ChangeLog::apply(pool, lines.data(), lines.size(), used, edits);
+        }
+        catch (const std::exception& e) {
+            if (error && error->empty()) *error = e.what();
+            if (applied) applied->append(lines.data(), used);
+            total += edits;
+            lines.remove_prefix(lines.find('\n', used) + 1);
+            continue;
+        }
+        if (applied) applied->append(lines.data(), used);
+        total += edits;
+        break;
+    }
+    return total;
+}
@@ -0,0 +1,82 @@
+#ifndef CONCURRENTPOOL_H
+#define CONCURRENTPOOL_H
+
+#include "family.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// A GenePool that many threads can query while one thread edits it.
+//
+// There are two copies of the pool. Readers only ever see the published
+// copy, and never wait or lock: entering a read announces the current
+// epoch in a slot of the reader table, and leaving clears it. The writer
+// edits the other copy, publishes it with one pointer swap, waits for the
+// readers still on the old copy to leave, and then makes the same edits
+// there, so the copies take turns. (This is the left-right scheme: every
+// edit is made twice, in exchange for reads that cost two atomic stores.)
+//
+// Each read sees one consistent version of the whole pool, from a single
+// update() to the next. Edits are change-log lines (see ChangeLog), which
+// both copies apply the same way. They drop the closure and LCA indexes,
+// as GenePool's edits do, so build those once loading is done if at all.
+class ConcurrentPool {
+  static const size_t SLOTS = 128;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0};  // 0 when free
+  };
+
+  // Member Variables
+  std::unique_ptr<GenePool> m_pools[2];
+  std::atomic<GenePool*>    m_current;
+  std::atomic<uint64_t>     m_epoch{1};
+  mutable Slot              m_slots[SLOTS];
+
+  // Helper Functions
+  void publish();
+  size_t edit(GenePool& pool, std::string_view lines, std::string* applied, std::string* error);
+
+public:
+  // A read of the published copy; the pool (and every Person or PersonSet
+  // from it) may only be used while the Reader is alive.
+  class Reader {
+    const GenePool* m_pool;
+    Slot*           m_slot;
+
+  public:
+    Reader(const GenePool* pool, Slot* slot) : m_pool(pool), m_slot(slot) {}
+    Reader(Reader&& other) noexcept : m_pool(other.m_pool), m_slot(other.m_slot) { other.m_slot = nullptr; }
+    Reader(const Reader& other) = delete;
+    Reader& operator = (const Reader& other) = delete;
+    ~Reader() { if (m_slot) m_slot->epoch.store(0, std::memory_order_release); }
+
+    const GenePool& operator * () const { return *m_pool; }
+    const GenePool* operator -> () const { return m_pool; }
+  };
+
+  // Load both copies from the same TSV text, or open the same snapshot twice.
+  ConcurrentPool(const char* data, size_t size, LoadMode mode = LoadMode::IN_ORDER);
+  ConcurrentPool(std::shared_ptr<const MappedFile> snapshot, bool verify = false);
+
+  // Give each copy a cache of answers of up to bytes (see
+  // GenePool::enableCache()). Readers share the published copy's cache,
+  // and edits keep both exact. Call before reads start.
+  void enableCache(size_t bytes);
+
+  // Any thread: start reading the published copy.
+  Reader read() const;
+
+  // One thread at a time: apply change-log lines to both copies, publishing
+  // the first as soon as it has them all. Returns the edits made. Lines that
+  // cannot be applied are skipped; if there were any, this throws
+  // std::runtime_error about the first once the others are published.
+  size_t update(std::string_view lines);
+
+  // How many updates have been published.
+  uint64_t version() const { return m_epoch.load(std::memory_order_acquire) - 1; }
+};
+
+#endif
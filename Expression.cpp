@@ -0,0 +1,343 @@
+#include "Expression.h"
+// Expression Member Functions
+#include "family.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Frontiers at least this large are expanded in bulk.
+static const size_t BULK = 64;
+
+struct Expression::Run {
+    const GenePool& pool;
+    std::vector<PersonID> ids;                  // PERSON nodes, once resolved
+    std::vector<double> estimates;              // Negative until estimated
+    std::vector<char> done;
+    std::vector<PersonSet> values;              // Arrays or bitsets, by density
+    std::vector<PersonID> frontier;
+    std::vector<PersonID> found;
+
+    Run(const GenePool& pool, size_t nodes)
+        : pool(pool), ids(nodes, NO_PERSON), estimates(nodes, -1), done(nodes, 0), values(nodes, PersonSet(&pool)) {}
+};
+
+// Building
+Expression::Node Expression::add(Entry entry) {
+    for (Node node = 0; node < m_nodes.size(); ++node) {
+        const Entry& other = m_nodes[node];
+        if (other.kind == entry.kind && other.left == entry.left && other.right == entry.right &&
+            other.name == entry.name && other.relationship == entry.relationship &&
+            other.pmod == entry.pmod && other.smod == entry.smod) {
+            return node;
+        }
+    }
+
+    m_nodes.push_back(std::move(entry));
+    return static_cast<Node>(m_nodes.size() - 1);
+}
+
+Expression::Node Expression::person(const std::string& name) {
+    Entry entry;
+    entry.kind = Kind::PERSON;
+    entry.name = name;
+    return add(std::move(entry));
+}
+
+Expression::Node Expression::everyone() {
+    Entry entry;
+    entry.kind = Kind::EVERYONE;
+    return add(std::move(entry));
+}
+
+/*
+Check the modifiers and compile the plan. Asking for "everyone" as a
+relationship gives everyone, whoever it is asked of, as it always has.
+*/
+Expression::Node Expression::hop(Node from, Relationship relationship, PMod pmod, SMod smod) {
+    if (relationship == Relationship::EVERYONE) {
+        return everyone();
+    }
+    if (!allowsPMod(relationship) && pmod != PMod::ANY) {
+        throw std::invalid_argument(std::string("Parent modifier is not allowed in ") + ::to_string(relationship) + " queries.");
+    }
+    if (!allowsSMod(relationship) && smod != SMod::ANY) {
+        throw std::invalid_argument(std::string("Sibling modifier is not allowed in ") + ::to_string(relationship) + " queries.");
+    }
+
+    Entry entry;
+    entry.kind = Kind::HOP;
+    entry.left = from;
+    entry.relationship = relationship;
+    entry.pmod = pmod;
+    entry.smod = smod;
+    entry.plan = Plan::compile(relationship, pmod, smod);
+    return add(std::move(entry));
+}
+
+Expression::Node Expression::combine(Kind kind, Node left, Node right) {
+    Entry entry;
+    entry.kind = kind;
+    entry.left = left;
+    entry.right = right;
+    return add(std::move(entry));
+}
+
+// Helper Functions
+// Look up everyone named under node, so a missing name is reported even
+// if the branch it is in never needs to run.
+void Expression::resolve(Run& run, Node node) const {
+    const Entry& entry = m_nodes[node];
+    switch (entry.kind) {
+        case Kind::PERSON: {
+            if (run.ids[node] != NO_PERSON) return;
+            Person* person = run.pool.find(entry.name);
+            if (person == nullptr) {
+                throw std::invalid_argument("No such person: " + entry.name);
+            }
+            run.ids[node] = person->id();
+            return;
+        }
+        case Kind::EVERYONE:
+            return;
+        case Kind::HOP:
+            resolve(run, entry.left);
+            return;
+        default:
+            resolve(run, entry.left);
+            resolve(run, entry.right);
+            return;
+    }
+}
+
+/*
+A rough size for node's result, from the shape of each plan: two parents,
+the average family's worth of children or siblings (half that with a
+gender filter), and the square root of the pool for a whole closure that
+the index cannot count.
+*/
+double Expression::estimate(Run& run, Node node) const {
+    if (run.estimates[node] >= 0) return run.estimates[node];
+
+    const Entry& entry = m_nodes[node];
+    const PersonStore& store = run.pool.store();
+    double people = static_cast<double>(std::max<size_t>(store.size(), 1));
+    double result = 1;
+    size_t count;
+    if (counted(run, node, count)) {
+        run.estimates[node] = static_cast<double>(count);
+        return run.estimates[node];
+    }
+
+    switch (entry.kind) {
+        case Kind::PERSON:   result = 1; break;
+        case Kind::EVERYONE: result = people; break;
+        case Kind::HOP: {
+            double links = static_cast<double>(store.section(PersonStore::CHILD_IDS).second / sizeof(PersonID));
+            double family = std::max(1.0, 2 * links / people);
+            result = estimate(run, entry.left);
+            for (size_t i = 0; i < entry.plan.size(); ++i) {
+                const Plan::Step& step = entry.plan[i];
+                double half = step.gender == Gender::ANY ? 1 : 0.5;
+                switch (step.op) {
+                    case Plan::Op::PARENTS:     result *= step.pmod == PMod::ANY ? 2 : 1; break;
+                    case Plan::Op::CHILDREN:    result *= family * half; break;
+                    case Plan::Op::SIBLINGS:    result *= family * half; break;
+                    case Plan::Op::ANCESTORS:   result *= std::sqrt(people); break;
+                    case Plan::Op::DESCENDANTS: result *= std::sqrt(people); break;
+                }
+            }
+            break;
+        }
+        case Kind::AND:   result = std::min(estimate(run, entry.left), estimate(run, entry.right)); break;
+        case Kind::OR:    result = estimate(run, entry.left) + estimate(run, entry.right); break;
+        case Kind::MINUS: result = estimate(run, entry.left); break;
+    }
+
+    run.estimates[node] = std::min(result, people);
+    return run.estimates[node];
+}
+
+/*
+If node is one person's whole ancestors or descendants, and the closure
+index labels that person, count them exactly. Labeled people can also be
+tested against in constant time.
+*/
+bool Expression::counted(Run& run, Node node, size_t& count) const {
+    const Entry& entry = m_nodes[node];
+    const ClosureIndex* index = run.pool.closure();
+    if (index == nullptr || entry.kind != Kind::HOP || entry.plan.size() != 1) return false;
+    if (m_nodes[entry.left].kind != Kind::PERSON) return false;
+
+    const Plan::Step& step = entry.plan[0];
+    PersonID from = run.ids[entry.left];
+    if (step.op == Plan::Op::DESCENDANTS) return index->count_descendants(from, count);
+    if (step.op == Plan::Op::ANCESTORS && step.pmod == PMod::ANY) return index->count_ancestors(from, count);
+    return false;
+}
+
+// Is it cheaper to test candidates against node than to list node?
+bool Expression::probes(Run& run, Node node, size_t candidates) const {
+    size_t count;
+    return !run.done[node] && counted(run, node, count) && candidates < count;
+}
+
+// Keep (or, with keep false, drop) the people who are in a node probes() allowed.
+void Expression::filter(Run& run, Node node, PersonSet& people, bool keep) const {
+    const Entry& entry = m_nodes[node];
+    const ClosureIndex* index = run.pool.closure();
+    PersonID from = run.ids[entry.left];
+    bool down = entry.plan[0].op == Plan::Op::DESCENDANTS;
+
+    std::vector<PersonID>& ids = run.found;
+    ids.clear();
+    people.ids(ids);
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&](PersonID id) {
+        bool in = down ? index->is_ancestor(from, id) : index->is_ancestor(id, from);
+        return in != keep;
+    }), ids.end());
+
+    people.clear();
+    people.insert(ids.data(), ids.data() + ids.size());
+}
+
+// Evaluate
+const PersonSet& Expression::evaluate(Run& run, Node node) const {
+    PersonSet& result = run.values[node];
+    if (run.done[node]) return result;
+
+    const Entry& entry = m_nodes[node];
+    switch (entry.kind) {
+        case Kind::PERSON: {
+            result.insert(run.ids[node]);
+            break;
+        }
+
+        case Kind::EVERYONE: {
+            result = run.pool.everyone();
+            break;
+        }
+
+        // The frontier below is already free of repeats, so each person in
+        // it is expanded once, however many ways they were reached. Large
+        // frontiers go through the bulk expander a step at a time; small
+        // ones use the pool's cache of answers, if it has one.
+        case Kind::HOP: {
+            const PersonSet& from = evaluate(run, entry.left);
+            Trace::Span span;
+            std::vector<PersonID>& frontier = run.frontier;
+            frontier.clear();
+            from.ids(frontier);
+            if (frontier.size() >= BULK) {
+                FrontierExpander& expander = FrontierExpander::local();
+                expander.run(run.pool, entry.plan, frontier.data(), frontier.data() + frontier.size());
+                result.insert(expander.ids().data(), expander.ids().data() + expander.ids().size());
+            }
+            else {
+                run.found.clear();
+                RelationshipCache* cache = run.pool.cache();
+                for (PersonID id : frontier) {
+                    if (cache == nullptr) {
+                        entry.plan.expand(run.pool, id, run.found);
+                        continue;
+                    }
+                    if (cache->find(id, entry.relationship, entry.pmod, entry.smod, run.found)) continue;
+
+                    size_t start = run.found.size();
+                    entry.plan.expand(run.pool, id, run.found);
+                    cache->insert(id, entry.relationship, entry.pmod, entry.smod, run.found.data() + start, run.found.data() + run.found.size());
+                }
+                result.insert(run.found.data(), run.found.data() + run.found.size());
+            }
+            span.done(Trace::Kind::HOP, result.size(), entry.relationship);
+            break;
+        }
+
+        // Flatten a chain of ANDs and take the operands smallest first,
+        // stopping as soon as nothing is left.
+        case Kind::AND: {
+            std::vector<Node> operands;
+            std::vector<Node> pending(1, node);
+            while (!pending.empty()) {
+                Node next = pending.back();
+                pending.pop_back();
+                if (m_nodes[next].kind == Kind::AND && !run.done[next]) {
+                    pending.push_back(m_nodes[next].right);
+                    pending.push_back(m_nodes[next].left);
+                }
+                else {
+                    operands.push_back(next);
+                }
+            }
+            std::stable_sort(operands.begin(), operands.end(), [&](Node a, Node b) {
+                return estimate(run, a) < estimate(run, b);
+            });
+
+            result = evaluate(run, operands[0]);
+            for (size_t i = 1; i < operands.size() && !result.empty(); ++i) {
+                if (probes(run, operands[i], result.size())) {
+                    filter(run, operands[i], result, true);
+                    continue;
+                }
+
+                result.intersect(evaluate(run, operands[i]));
+            }
+            break;
+        }
+
+        case Kind::OR: {
+            result = evaluate(run, entry.left);
+            result.merge(evaluate(run, entry.right));
+            break;
+        }
+
+        case Kind::MINUS: {
+            result = evaluate(run, entry.left);
+            if (result.empty()) break;
+            if (probes(run, entry.right, result.size())) {
+                filter(run, entry.right, result, false);
+                break;
+            }
+
+            result.subtract(evaluate(run, entry.right));
+            break;
+        }
+    }
+
+    run.done[node] = 1;
+    return result;
+}
+
+PersonSet Expression::run(const GenePool& pool) const {
+    if (m_nodes.empty()) {
+        throw std::invalid_argument("Too few terms in query.");
+    }
+
+    Run state(pool, m_nodes.size());
+    resolve(state, m_root);
+
+    evaluate(state, m_root);
+    return std::move(state.values[m_root]);
+}
+
+// Writing
+std::string Expression::to_string(Node node) const {
+    const Entry& entry = m_nodes[node];
+    switch (entry.kind) {
+        case Kind::PERSON:   return entry.name;
+        case Kind::EVERYONE: return "everyone";
+        case Kind::HOP: {
+            std::string from = to_string(entry.left);
+            std::string result = from + (m_nodes[entry.left].kind != Kind::PERSON && from.back() == 's' ? "' " : "'s ");
+            if (entry.pmod == PMod::MATERNAL) result += "maternal ";
+            if (entry.pmod == PMod::PATERNAL) result += "paternal ";
+            if (entry.smod == SMod::FULL) result += "full ";
+            if (entry.smod == SMod::HALF) result += "half ";
+            return result + ::to_string(entry.relationship);
+        }
+        case Kind::AND:   return "(" + to_string(entry.left) + " & " + to_string(entry.right) + ")";
+        case Kind::OR:    return "(" + to_string(entry.left) + " | " + to_string(entry.right) + ")";
+        case Kind::MINUS: return "(" + to_string(entry.left) + " - " + to_string(entry.right) + ")";
+    }
+    return std::string();
+}
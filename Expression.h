@@ -0,0 +1,85 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "PersonSet.h"
+#include "PersonStore.h"
+#include "Plan.h"
+#include "Roles.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GenePool;
+
+// A parsed query: relationship hops chained off people, combined with set
+// algebra. Nodes are shared, so a subexpression that appears twice (say,
+// "A's cousins" in "A's cousins' sons | A's cousins' daughters") is one
+// node and is computed once.
+//
+// Running an expression works on whole frontiers: each hop runs its plan
+// from every member of the set below it, which is de-duplicated first, so
+// nobody is expanded twice. Estimated sizes decide the order of work:
+// intersections start with their smallest operand and stop as soon as the
+// running result is empty. With a closure index, someone's ancestors or
+// descendants are counted exactly, and small sets are tested against them
+// instead of listing them.
+class Expression {
+public:
+  typedef uint32_t Node;
+
+  enum class Kind : unsigned char {
+    PERSON,    // One person, by name
+    EVERYONE,  // Everyone in the pool
+    HOP,       // A relationship of everyone in left
+    AND,       // In both left and right
+    OR,        // In left or right (or both)
+    MINUS,     // In left but not right
+  };
+
+private:
+  struct Entry {
+    Kind         kind;
+    Node         left  = 0;
+    Node         right = 0;
+    std::string  name;
+    Relationship relationship = Relationship::EVERYONE;
+    PMod         pmod = PMod::ANY;
+    SMod         smod = SMod::ANY;
+    Plan         plan;
+  };
+
+  // Member Variables
+  std::vector<Entry> m_nodes;
+  Node m_root = 0;
+
+  // Working state for one run(), defined in Expression.cpp.
+  struct Run;
+
+  // Helper Functions
+  Node add(Entry entry);
+  void resolve(Run& run, Node node) const;
+  bool counted(Run& run, Node node, size_t& count) const;
+  double estimate(Run& run, Node node) const;
+  bool probes(Run& run, Node node, size_t candidates) const;
+  void filter(Run& run, Node node, PersonSet& people, bool keep) const;
+  const PersonSet& evaluate(Run& run, Node node) const;
+  std::string to_string(Node node) const;
+
+public:
+  // Building: each returns the (possibly existing) node for its arguments.
+  Node person(const std::string& name);
+  Node everyone();
+  Node hop(Node from, Relationship relationship, PMod pmod = PMod::ANY, SMod smod = SMod::ANY);
+  Node combine(Kind kind, Node left, Node right);
+
+  void setRoot(Node root) { m_root = root; }
+  size_t size() const { return m_nodes.size(); }
+
+  // Evaluate the whole expression.
+  PersonSet run(const GenePool& pool) const;
+
+  // Write the expression back out as a query.
+  std::string to_string() const { return to_string(m_root); }
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include "Frontier.h"
+// FrontierExpander Member Functions
+#include "family.h"
+#include "Tracing.h"
+#include "Traversal.h"
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+Masks are worked out with the same expressions on two lane types: Lane
+holds one person, and Lanes (with SSE2) holds four. A mask lane is all
+ones for true and all zeros for false.
+*/
+namespace {
+    struct Lane {
+        static const size_t WIDTH = 1;
+        uint32_t v;
+
+        static Lane load(const uint32_t* data) { return Lane{*data}; }
+        static Lane all(uint32_t value) { return Lane{value}; }
+        unsigned bits() const { return v & 1; }
+    };
+
+    inline Lane operator & (Lane a, Lane b) { return Lane{a.v & b.v}; }
+    inline Lane operator | (Lane a, Lane b) { return Lane{a.v | b.v}; }
+    inline Lane operator ~ (Lane a) { return Lane{~a.v}; }
+    inline Lane eq(Lane a, Lane b) { return Lane{a.v == b.v ? ~0u : 0u}; }
+
+#if defined(__SSE2__)
+    struct Lanes {
+        static const size_t WIDTH = 4;
+        __m128i v;
+
+        static Lanes load(const uint32_t* data) { return Lanes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))}; }
+        static Lanes all(uint32_t value) { return Lanes{_mm_set1_epi32(static_cast<int>(value))}; }
+        unsigned bits() const { return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(v))); }
+    };
+
+    inline Lanes operator & (Lanes a, Lanes b) { return Lanes{_mm_and_si128(a.v, b.v)}; }
+    inline Lanes operator | (Lanes a, Lanes b) { return Lanes{_mm_or_si128(a.v, b.v)}; }
+    inline Lanes operator ~ (Lanes a) { return Lanes{_mm_xor_si128(a.v, _mm_set1_epi32(-1))}; }
+    inline Lanes eq(Lanes a, Lanes b) { return Lanes{_mm_cmpeq_epi32(a.v, b.v)}; }
+
+    typedef Lanes Wide;
+#else
+    typedef Lane Wide;
+#endif
+
+    /*
+    Keep the entries of [0, count) whose lanes mask(L(), i) sets, calling
+    move(from, to) to pack them at the front. Returns how many were kept.
+    */
+    template <typename Mask, typename Move>
+    size_t compact(size_t count, Mask mask, Move move) {
+        size_t kept = 0;
+        size_t i = 0;
+        for (; i + Wide::WIDTH <= count; i += Wide::WIDTH) {
+            unsigned bits = mask(Wide(), i).bits();
+            for (unsigned j = 0; bits != 0; ++j, bits >>= 1) {
+                if (bits & 1) move(i + j, kept++);
+            }
+        }
+        for (; i < count; ++i) {
+            if (mask(Lane(), i).bits()) move(i, kept++);
+        }
+        return kept;
+    }
+
+    // Frontiers of at least 1 / ALIGN of the pool use aligned columns.
+    const size_t ALIGN = 8;
+
+    bool allows(PMod pmod, PMod side) {
+        return pmod == PMod::ANY || pmod == side;
+    }
+
+    uint32_t flag(bool value) {
+        return value ? ~0u : 0u;
+    }
+}
+
+FrontierExpander& FrontierExpander::local() {
+    thread_local FrontierExpander expander;
+    return expander;
+}
+
+// Helper Functions
+void FrontierExpander::parents(const PersonStore& store, const Plan::Step& step) {
+    bool maternal = allows(step.pmod, PMod::MATERNAL);
+    bool paternal = allows(step.pmod, PMod::PATERNAL);
+    m_nextOwners.resize(2 * m_ids.size());
+    m_nextIds.resize(2 * m_ids.size());
+
+    size_t kept = 0;
+    for (size_t k = 0; k < m_ids.size(); ++k) {
+        PersonID mother = store.mother(m_ids[k]);
+        PersonID father = store.father(m_ids[k]);
+        m_nextOwners[kept] = m_owners[k];
+        m_nextIds[kept] = mother;
+        kept += maternal && mother != NO_PERSON;
+        m_nextOwners[kept] = m_owners[k];
+        m_nextIds[kept] = father;
+        kept += paternal && father != NO_PERSON;
+    }
+    m_nextOwners.resize(kept);
+    m_nextIds.resize(kept);
+}
+
+/*
+Lay out every child's parents and gender in the order of the store's
+children lists, so a family's columns are one contiguous run. Sibling
+steps over a large frontier would otherwise gather each family once per
+member.
+*/
+void FrontierExpander::align(const PersonStore& store) {
+    IDRange all = store.childLists();
+    m_childMothers.resize(all.size());
+    m_childFathers.resize(all.size());
+    m_childGenders.resize(all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        m_childMothers[i] = store.mother(all[i]);
+        m_childFathers[i] = store.father(all[i]);
+        m_childGenders[i] = static_cast<uint32_t>(store.gender(all[i]));
+    }
+    m_aligned = true;
+}
+
+// Gather everyone's children, then mask out the wrong gender.
+void FrontierExpander::children(const PersonStore& store, const Plan::Step& step) {
+    size_t total = 0;
+    for (PersonID id : m_ids) {
+        total += store.children(id).size();
+    }
+    m_nextOwners.resize(total);
+    m_nextIds.resize(total);
+
+    size_t next = 0;
+    for (size_t k = 0; k < m_ids.size(); ++k) {
+        IDRange children = store.children(m_ids[k]);
+        std::fill_n(m_nextOwners.begin() + next, children.size(), m_owners[k]);
+        std::copy(children.begin(), children.end(), m_nextIds.begin() + next);
+        next += children.size();
+    }
+    if (step.gender == Gender::ANY) return;
+
+    std::vector<uint32_t>& genders = m_candidates.gender;
+    genders.resize(m_nextIds.size());
+    for (size_t k = 0; k < m_nextIds.size(); ++k) {
+        genders[k] = static_cast<uint32_t>(store.gender(m_nextIds[k]));
+    }
+
+    uint32_t wanted = static_cast<uint32_t>(step.gender);
+    size_t kept = compact(m_nextIds.size(), [&](auto lanes, size_t i) {
+        typedef decltype(lanes) L;
+        return eq(L::load(genders.data() + i), L::all(wanted));
+    }, [&](size_t from, size_t to) {
+        m_nextOwners[to] = m_nextOwners[from];
+        m_nextIds[to] = m_nextIds[from];
+    });
+    m_nextOwners.resize(kept);
+    m_nextIds.resize(kept);
+}
+
+/*
+Decide each allowed parent's children at once, as masks, with the same
+tests Plan uses. The person they would be a sibling of is the same in
+every lane; only the candidates' own parents and genders are gathered.
+  - never the person themself, and only the wanted gender;
+  - through the father, skip anyone also the mother's child, since the
+    mother's pass (if allowed) already considered them;
+  - MEMBERSHIP: full siblings are also the other parent's child;
+  - STRICT: the same parent in the same role, as pmod and smod require;
+  - BOTH: the two together.
+*/
+void FrontierExpander::siblings(const PersonStore& store, const Plan::Step& step) {
+    Candidates& c = m_candidates;
+    if (!m_aligned && m_ids.size() >= store.size() / ALIGN) align(store);
+
+    const PMod sides[2] = {PMod::MATERNAL, PMod::PATERNAL};
+    const uint32_t maternal = flag(allows(step.pmod, PMod::MATERNAL));
+    const uint32_t paternal = flag(allows(step.pmod, PMod::PATERNAL));
+    const uint32_t wanted   = static_cast<uint32_t>(step.gender);
+
+    // Size the output for every candidate, then write kept ones in place.
+    size_t total = 0;
+    for (PersonID id : m_ids) {
+        if (store.mother(id) != NO_PERSON && maternal) total += store.children(store.mother(id)).size();
+        if (store.father(id) != NO_PERSON && paternal) total += store.children(store.father(id)).size();
+    }
+    m_nextOwners.resize(total);
+    m_nextIds.resize(total);
+    uint32_t* owners = m_nextOwners.data();
+    PersonID* ids = m_nextIds.data();
+    size_t kept = 0;
+
+    for (size_t k = 0; k < m_ids.size(); ++k) {
+        const PersonID id = m_ids[k];
+        const uint32_t owner = m_owners[k];
+        const PersonID parents[2] = {store.mother(id), store.father(id)};
+
+        for (int side = 0; side < 2; ++side) {
+            if (parents[side] == NO_PERSON || !allows(step.pmod, sides[side])) continue;
+
+            IDRange family = store.children(parents[side]);
+            size_t count = family.size();
+            const PersonID* mothers;
+            const PersonID* fathers;
+            const uint32_t* genders;
+            if (m_aligned) {
+                size_t offset = family.first - store.childLists().first;
+                mothers = m_childMothers.data() + offset;
+                fathers = m_childFathers.data() + offset;
+                genders = m_childGenders.data() + offset;
+            }
+            else {
+                c.mother.resize(count);
+                c.father.resize(count);
+                c.gender.resize(count);
+                for (size_t i = 0; i < count; ++i) {
+                    c.mother[i] = store.mother(family[i]);
+                    c.father[i] = store.father(family[i]);
+                    c.gender[i] = static_cast<uint32_t>(store.gender(family[i]));
+                }
+                mothers = c.mother.data();
+                fathers = c.father.data();
+                genders = c.gender.data();
+            }
+
+            compact(count, [&](auto lanes, size_t i) {
+                typedef decltype(lanes) L;
+                const L m      = L::all(parents[0]);
+                const L f      = L::all(parents[1]);
+                const L knownM = L::all(flag(parents[0] != NO_PERSON));
+                const L knownF = L::all(flag(parents[1] != NO_PERSON));
+                L mother = L::load(mothers + i);
+                L father = L::load(fathers + i);
+
+                L keep = ~eq(L::load(family.first + i), L::all(id));
+                if (step.gender != Gender::ANY) {
+                    keep = keep & eq(L::load(genders + i), L::all(wanted));
+                }
+                if (side == 1) {
+                    keep = keep & ~(L::all(maternal) & knownM & (eq(mother, m) | eq(father, m)));
+                }
+
+                L member = L::all(~0u);
+                if (step.rule != Plan::Rule::STRICT && step.smod != SMod::ANY) {
+                    PersonID other = parents[1 - side];
+                    L isFull = L::all(flag(other != NO_PERSON)) & (eq(mother, L::all(other)) | eq(father, L::all(other)));
+                    member = step.smod == SMod::FULL ? isFull : ~isFull;
+                }
+
+                L shares = L::all(~0u);
+                if (step.rule != Plan::Rule::MEMBERSHIP) {
+                    L sameMother = knownM & eq(mother, m);
+                    L sameFather = knownF & eq(father, f);
+                    if (step.smod == SMod::FULL) {
+                        shares = sameMother & sameFather;
+                    }
+                    else if (step.smod == SMod::HALF) {
+                        shares = (L::all(maternal) & sameMother & ~sameFather) | (L::all(paternal) & sameFather & ~sameMother);
+                    }
+                    else {
+                        shares = (L::all(maternal) & sameMother) | (L::all(paternal) & sameFather);
+                    }
+                }
+
+                return keep & member & shares;
+            }, [&](size_t from, size_t) {
+                owners[kept] = owner;
+                ids[kept++] = family[from];
+            });
+        }
+    }
+    m_nextOwners.resize(kept);
+    m_nextIds.resize(kept);
+}
+
+// From the closure index where it covers someone, otherwise with a walk.
+void FrontierExpander::closure(const GenePool& pool, const Plan::Step& step) {
+    const ClosureIndex* index = pool.closure();
+    std::vector<PersonID>& reached = m_candidates.reached;
+
+    for (size_t k = 0; k < m_ids.size(); ++k) {
+        reached.clear();
+        bool indexed = step.op == Plan::Op::ANCESTORS ?
+            index && index->ancestors(m_ids[k], step.pmod, reached) :
+            index && index->descendants(m_ids[k], reached);
+
+        const std::vector<PersonID>* ids = &reached;
+        if (!indexed) {
+            ids = step.op == Plan::Op::ANCESTORS ?
+                &Traversal::local().ancestors(pool.store(), m_ids[k], step.pmod) :
+                &Traversal::local().descendants(pool.store(), m_ids[k]);
+        }
+        m_nextOwners.insert(m_nextOwners.end(), ids->size(), m_owners[k]);
+        m_nextIds.insert(m_nextIds.end(), ids->begin(), ids->end());
+    }
+}
+
+/*
+Drop repeats within each source's group, keeping first appearances, with
+a bitset over person IDs. Only bits for the current group are ever set,
+and they are cleared before the next group starts.
+*/
+void FrontierExpander::unique(size_t people) {
+    m_seen.resize((people + 63) / 64);
+
+    size_t kept = 0;
+    for (size_t k = 0; k < m_ids.size();) {
+        const uint32_t owner = m_owners[k];
+        const size_t first = kept;
+        for (; k < m_ids.size() && m_owners[k] == owner; ++k) {
+            PersonID id = m_ids[k];
+            uint64_t bit = uint64_t(1) << (id % 64);
+            if (m_seen[id / 64] & bit) continue;
+
+            m_seen[id / 64] |= bit;
+            m_owners[kept] = owner;
+            m_ids[kept++] = id;
+        }
+        for (size_t i = first; i < kept; ++i) {
+            m_seen[m_ids[i] / 64] = 0;
+        }
+    }
+
+    m_owners.resize(kept);
+    m_ids.resize(kept);
+}
+
+// Run
+void FrontierExpander::run(const GenePool& pool, const Plan& plan, const PersonID* first, const PersonID* last) {
+    size_t count = last - first;
+    m_owners.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        m_owners[k] = static_cast<uint32_t>(k);
+    }
+    m_ids.assign(first, last);
+    m_aligned = false;
+    if (pool.store().size() == 0) return;
+
+    for (size_t i = 0; i < plan.size() && !m_ids.empty(); ++i) {
+        const Plan::Step& step = plan[i];
+        Trace::visit(m_ids.size());
+        m_nextOwners.clear();
+        m_nextIds.clear();
+
+        switch (step.op) {
+            case Plan::Op::PARENTS:     parents(pool.store(), step); break;
+            case Plan::Op::CHILDREN:    children(pool.store(), step); break;
+            case Plan::Op::SIBLINGS:    siblings(pool.store(), step); break;
+            case Plan::Op::ANCESTORS:   closure(pool, step); break;
+            case Plan::Op::DESCENDANTS: closure(pool, step); break;
+        }
+
+        m_owners.swap(m_nextOwners);
+        m_ids.swap(m_nextIds);
+
+        // One person's parents, children or siblings never repeat, and
+        // the caller sorts the last step's results anyway.
+        if (i > 0 && i + 1 < plan.size()) {
+            unique(pool.store().size());
+        }
+    }
+}
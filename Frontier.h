@@ -0,0 +1,79 @@
+#ifndef FRONTIER_H
+#define FRONTIER_H
+
+#include "Plan.h"
+#include "PersonStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GenePool;
+
+// One relationship for many people at once: the results for person i of
+// the frontier are ids[offsets[i] .. offsets[i + 1]), sorted.
+struct Expansion {
+  std::vector<uint32_t> offsets;
+  std::vector<PersonID> ids;
+
+  size_t  size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+  IDRange operator [] (size_t i) const {
+    return IDRange{ids.data() + offsets[i], ids.data() + offsets[i + 1]};
+  }
+};
+
+// Runs a plan over a whole frontier a step at a time, instead of person by
+// person. Each step turns every (source, person) pair into the next pairs
+// with straight passes over the store's arrays: parent and child lookups
+// are gathers, and gender and full/half/strict sibling tests are worked out
+// as lane masks, four people at a time with SSE2 (one at a time otherwise),
+// then compacted. Closure steps still walk (or use the index) per person.
+//
+// Pairs stay grouped by source, in frontier order, from step to step, and
+// repeats within a source are dropped between steps, so later steps do not
+// expand anyone twice.
+class FrontierExpander {
+  // Member Variables
+  std::vector<uint32_t> m_owners;
+  std::vector<PersonID> m_ids;
+
+  // Scratch columns: candidates' parents and genders, widened to lanes.
+  struct Candidates {
+    std::vector<PersonID> mother;
+    std::vector<PersonID> father;
+    std::vector<uint32_t> gender;
+    std::vector<PersonID> reached;
+  };
+  Candidates m_candidates;
+
+  // Each child's parents and gender, in children-list order (see align()).
+  std::vector<PersonID> m_childMothers;
+  std::vector<PersonID> m_childFathers;
+  std::vector<uint32_t> m_childGenders;
+  bool m_aligned = false;
+
+  std::vector<uint64_t> m_seen;  // Visited bits, all clear between groups
+  std::vector<uint32_t> m_nextOwners;
+  std::vector<PersonID> m_nextIds;
+
+  // Helper Functions
+  void align(const PersonStore& store);
+  void parents(const PersonStore& store, const Plan::Step& step);
+  void children(const PersonStore& store, const Plan::Step& step);
+  void siblings(const PersonStore& store, const Plan::Step& step);
+  void closure(const GenePool& pool, const Plan::Step& step);
+  void unique(size_t people);
+
+public:
+  // An expander for the calling thread, reused between runs.
+  static FrontierExpander& local();
+
+  // Run plan from everyone in [first, last). Afterwards, owners()[k] is the
+  // frontier index that reached ids()[k]; results may repeat, and are only
+  // valid until the next run on this expander.
+  void run(const GenePool& pool, const Plan& plan, const PersonID* first, const PersonID* last);
+
+  const std::vector<uint32_t>& owners() const { return m_owners; }
+  const std::vector<PersonID>& ids() const { return m_ids; }
+};
+
+#endif
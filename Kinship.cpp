@@ -0,0 +1,261 @@
+#include "Kinship.h"
+// Kinship Member Functions
+#include <algorithm>
+
+namespace {
+    const uint32_t UNSEEN = UINT32_MAX;
+
+    // Which of a's parents a line of ancestors starts from:
+    const uint8_t MATERNAL_LINE = 1;
+    const uint8_t PATERNAL_LINE = 2;
+
+    std::string greats(uint32_t count) {
+        std::string result;
+        while (count-- > 0) result += "great-";
+        return result;
+    }
+
+    std::string ordinal(uint32_t n) {
+        static const char* const WORDS[] = {
+            "zeroth", "first", "second", "third", "fourth", "fifth",
+            "sixth", "seventh", "eighth", "ninth", "tenth"
+        };
+        if (n <= 10) return WORDS[n];
+
+        const char* suffix = "th";
+        if (n % 100 < 11 || n % 100 > 13) {
+            if (n % 10 == 1) suffix = "st";
+            if (n % 10 == 2) suffix = "nd";
+            if (n % 10 == 3) suffix = "rd";
+        }
+        return std::to_string(n) + suffix;
+    }
+
+    std::string removed(uint32_t n) {
+        if (n == 0) return "";
+        if (n == 1) return " once removed";
+        if (n == 2) return " twice removed";
+        return " " + std::to_string(n) + " times removed";
+    }
+}
+
+// Naming
+std::string to_string(const Kinship& kinship, Gender gender) {
+    if (!kinship.related()) return "no relation";
+
+    auto word = [gender](const char* male, const char* female, const char* either) {
+        return std::string(gender == Gender::MALE ? male : gender == Gender::FEMALE ? female : either);
+    };
+
+    uint32_t up = kinship.up;
+    uint32_t down = kinship.down;
+    std::string name;
+    if (up == 0 && down == 0) return "self";
+    else if (up == 0 && down == 1) name = word("son", "daughter", "child");
+    else if (up == 0) name = greats(down - 2) + "grand" + word("son", "daughter", "child");
+    else if (down == 0 && up == 1) name = word("father", "mother", "parent");
+    else if (down == 0) name = greats(up - 2) + "grand" + word("father", "mother", "parent");
+    else if (up == 1 && down == 1) name = word("brother", "sister", "sibling");
+    else if (up == 1) name = greats(down - 2) + word("nephew", "niece", "nephew or niece");
+    else if (down == 1) name = greats(up - 2) + word("uncle", "aunt", "uncle or aunt");
+    else name = ordinal(std::min(up, down) - 1) + " cousin" + removed(std::max(up, down) - std::min(up, down));
+
+    std::string result;
+    if (kinship.side == PMod::MATERNAL) result += "maternal ";
+    if (kinship.side == PMod::PATERNAL) result += "paternal ";
+    if (kinship.smod == SMod::HALF) result += "half ";
+    return result + name;
+}
+
+// Generations
+/*
+Kahn's algorithm over the child links, as in PersonStore::findCycle():
+people are retired once both their parents have been, so each parent's
+generation is final before their children's is worked out.
+*/
+std::vector<uint32_t> KinshipSolver::generations(const PersonStore& store) {
+    size_t count = store.size();
+    std::vector<uint32_t> result(count, 0);
+    std::vector<uint8_t>  pending(count);
+    std::vector<PersonID> ready;
+
+    for (size_t i = 0; i < count; ++i) {
+        PersonID mother = store.mother(static_cast<PersonID>(i));
+        PersonID father = store.father(static_cast<PersonID>(i));
+        pending[i] = (mother != NO_PERSON) + (father != NO_PERSON && father != mother);
+        if (pending[i] == 0) ready.push_back(static_cast<PersonID>(i));
+    }
+
+    while (!ready.empty()) {
+        PersonID id = ready.back();
+        ready.pop_back();
+        for (PersonID child : store.children(id)) {
+            result[child] = std::max(result[child], result[id] + 1);
+            if (--pending[child] == 0) ready.push_back(child);
+        }
+    }
+
+    return result;
+}
+
+// Search
+KinshipSolver& KinshipSolver::local() {
+    thread_local KinshipSolver solver;
+    return solver;
+}
+
+// Make sure the distance arrays cover every ID and start a and b off.
+void KinshipSolver::prepare(const PersonStore& store, PersonID a, PersonID b) {
+    PersonID starts[2] = {a, b};
+    for (int s = 0; s < 2; ++s) {
+        Side& side = m_sides[s];
+        if (side.distance.size() < store.size()) {
+            side.distance.resize(store.size(), UNSEEN);
+            side.branch.resize(store.size(), 0);
+        }
+        side.distance[starts[s]] = 0;
+        side.reached.assign(1, starts[s]);
+        side.frontier.assign(1, starts[s]);
+        side.level = 0;
+        side.deepest = UNSEEN;
+    }
+}
+
+/*
+Take one side up a generation. New people whom the other side has already
+reached are common ancestors; best keeps the closest total so far. On a's
+side, each person also remembers which of a's parents leads to them.
+*/
+void KinshipSolver::climb(const PersonStore& store, const std::vector<uint32_t>& generations, int s, PersonID other, uint32_t& best) {
+    Side& side = m_sides[s];
+    const Side& them = m_sides[1 - s];
+    uint32_t level = side.level + 1;
+
+    side.next.clear();
+    for (PersonID id : side.frontier) {
+        PersonID parents[2] = {store.mother(id), store.father(id)};
+        for (int k = 0; k < 2; ++k) {
+            PersonID parent = parents[k];
+            if (parent == NO_PERSON) continue;
+
+            uint8_t line = side.level == 0 ? (k == 0 ? MATERNAL_LINE : PATERNAL_LINE) : side.branch[id];
+            if (side.distance[parent] == level) {
+                side.branch[parent] |= line;
+                continue;
+            }
+            if (side.distance[parent] != UNSEEN) continue;
+
+            side.distance[parent] = level;
+            side.branch[parent] = line;
+            side.reached.push_back(parent);
+            side.next.push_back(parent);
+            if (side.deepest == UNSEEN && generations[parent] < generations[other]) {
+                side.deepest = level;
+            }
+            if (them.distance[parent] != UNSEEN) {
+                best = std::min(best, level + them.distance[parent]);
+            }
+        }
+    }
+
+    side.frontier.swap(side.next);
+    side.level = level;
+}
+
+// Reset only what this search touched, so the next starts clean in O(reached).
+void KinshipSolver::finish() {
+    for (Side& side : m_sides) {
+        for (PersonID id : side.reached) {
+            side.distance[id] = UNSEEN;
+            side.branch[id] = 0;
+        }
+    }
+}
+
+/*
+A common ancestor neither side has reached yet is more than a generation
+past both frontiers. One only a's side has reached is an ancestor of b, so
+its generation is below b's; it is at least deepest steps from a (the
+closest such person a's side has seen) and past b's frontier. The same
+goes the other way round. The search stops once all three bounds are
+beyond the closest common ancestor found, and otherwise raises the lowest:
+by climbing the other side, or, if neither has met anyone, whichever side
+is further down the generations.
+*/
+Kinship KinshipSolver::solve(const PersonStore& store, const std::vector<uint32_t>& generations, PersonID a, PersonID b) {
+    Kinship result;
+    if (a == b) {
+        result.ancestor = a;
+        return result;
+    }
+
+    prepare(store, a, b);
+    Side& mine = m_sides[0];
+    Side& theirs = m_sides[1];
+    if (generations[a] < generations[b]) mine.deepest = 0;
+    if (generations[b] < generations[a]) theirs.deepest = 0;
+
+    const uint64_t NEVER = uint64_t(1) << 40;
+    uint32_t best = UNSEEN;
+    while (!mine.frontier.empty() || !theirs.frontier.empty()) {
+        uint64_t levelA = mine.frontier.empty() ? NEVER : mine.level;
+        uint64_t levelB = theirs.frontier.empty() ? NEVER : theirs.level;
+        uint64_t deepA  = mine.deepest == UNSEEN ? NEVER : mine.deepest;
+        uint64_t deepB  = theirs.deepest == UNSEEN ? NEVER : theirs.deepest;
+
+        uint64_t neither = levelA + levelB + 2;
+        uint64_t onlyA   = deepA + levelB + 1;
+        uint64_t onlyB   = deepB + levelA + 1;
+        uint64_t bound   = std::min(neither, std::min(onlyA, onlyB));
+        if (bound >= NEVER || (best != UNSEEN && bound > best)) break;
+
+        int s;
+        if (bound == onlyA) s = 1;
+        else if (bound == onlyB) s = 0;
+        else {
+            uint32_t lowA = 0;
+            uint32_t lowB = 0;
+            for (PersonID id : mine.frontier) lowA = std::max(lowA, generations[id]);
+            for (PersonID id : theirs.frontier) lowB = std::max(lowB, generations[id]);
+            s = lowA != lowB ? (lowA > lowB ? 0 : 1) : (mine.frontier.size() <= theirs.frontier.size() ? 0 : 1);
+        }
+        climb(store, generations, s, s == 0 ? b : a, best);
+    }
+
+    // Of the closest common ancestors, name the relationship after the one
+    // nearest both people; if they share a couple there, it is a full one.
+    if (best != UNSEEN) {
+        uint32_t shared = 0;
+        uint8_t lines = 0;
+        for (PersonID id : mine.reached) {
+            uint32_t up = mine.distance[id];
+            uint32_t down = theirs.distance[id];
+            if (down == UNSEEN || up + down != best) continue;
+
+            bool nearer = !result.related() || std::max(up, down) < std::max(result.up, result.down) ||
+                          (std::max(up, down) == std::max(result.up, result.down) && up < result.up);
+            if (nearer) {
+                result.ancestor = id;
+                result.up = up;
+                result.down = down;
+                shared = 0;
+                lines = 0;
+            }
+            if (up == result.up) {
+                shared += 1;
+                lines |= mine.branch[id];
+                result.ancestor = std::min(result.ancestor, id);
+            }
+        }
+
+        if (result.up > 1 || (result.up == 1 && result.down > 0)) {
+            result.side = lines == MATERNAL_LINE ? PMod::MATERNAL : lines == PATERNAL_LINE ? PMod::PATERNAL : PMod::ANY;
+        }
+        if (result.up > 0 && result.down > 0) {
+            result.smod = shared > 1 ? SMod::FULL : SMod::HALF;
+        }
+    }
+
+    finish();
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef KINSHIP_H
+#define KINSHIP_H
+
+#include "PersonStore.h"
+#include "Roles.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How one person is related to another, through their closest common
+// ancestor: a is up generations below it and b is down generations below
+// it. So b is one up and none down when b is a's parent, one and one for
+// siblings, and two and two for first cousins.
+struct Kinship {
+  PersonID ancestor = NO_PERSON;  // A closest common ancestor (maybe a or b)
+  uint32_t up       = 0;          // Generations from a up to the ancestor
+  uint32_t down     = 0;          // Generations from b up to the ancestor
+  PMod     side     = PMod::ANY;  // Which of a's parents leads to the ancestor
+  SMod     smod     = SMod::ANY;  // Half when only one of a couple is shared
+
+  bool related() const { return ancestor != NO_PERSON; }
+};
+
+// What b is to a, for a b of the given gender: "paternal half second
+// cousin once removed", "great-grandmother", "self".
+std::string to_string(const Kinship& kinship, Gender gender);
+
+// Finds closest common ancestors by searching up parent links from both
+// people at once, a generation at a time. Each person's generation (the
+// longest line of ancestors above them) bounds where a common ancestor can
+// still be, so the search stops as soon as nothing closer is possible: the
+// work depends on how far apart the two people are, not on the pool.
+class KinshipSolver {
+  struct Side {
+    std::vector<uint32_t> distance;  // UNSEEN unless reached
+    std::vector<uint8_t>  branch;    // Which of a's parents lead here (a's side)
+    std::vector<PersonID> reached;
+    std::vector<PersonID> frontier;
+    std::vector<PersonID> next;
+    uint32_t level;
+    uint32_t deepest;                // Closest level of a possible ancestor of the other
+  };
+
+  // Member Variables
+  Side m_sides[2];
+
+  // Helper Functions
+  void prepare(const PersonStore& store, PersonID a, PersonID b);
+  void climb(const PersonStore& store, const std::vector<uint32_t>& generations, int side, PersonID other, uint32_t& best);
+  void finish();
+
+public:
+  // A solver for the calling thread, reused between searches.
+  static KinshipSolver& local();
+
+  // Each person's generation: 0 for people with no known parents, otherwise
+  // one more than their deeper parent's.
+  static std::vector<uint32_t> generations(const PersonStore& store);
+
+  // How b is related to a. Kinship::related() is false if they share no
+  // ancestor.
+  Kinship solve(const PersonStore& store, const std::vector<uint32_t>& generations, PersonID a, PersonID b);
+};
+
+#endif
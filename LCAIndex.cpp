@@ -0,0 +1,125 @@
+#include "LCAIndex.h"
+// LCAIndex Member Functions
+#include <algorithm>
+#include <vector>
+
+/*
+Depths first: walk up from each person until someone whose depth is known
+(or the top of the line), then fill in the walk on the way back down, so
+everyone is visited once. Then each level of jumps is two jumps of the one
+before it.
+*/
+template <typename Parent>
+void LCAIndex::Line::build(size_t people, Parent parent) {
+    const uint32_t UNKNOWN = UINT32_MAX;
+    std::vector<uint32_t> depth(people, UNKNOWN);
+    std::vector<PersonID> walk;
+    uint32_t deepest = 0;
+
+    for (size_t i = 0; i < people; ++i) {
+        PersonID id = static_cast<PersonID>(i);
+        while (id != NO_PERSON && depth[id] == UNKNOWN) {
+            walk.push_back(id);
+            id = parent(id);
+        }
+
+        uint32_t above = id == NO_PERSON ? 0 : depth[id] + 1;
+        while (!walk.empty()) {
+            depth[walk.back()] = above++;
+            walk.pop_back();
+        }
+        deepest = std::max(deepest, depth[i]);
+    }
+
+    levels = 1;
+    while ((uint64_t(1) << levels) <= deepest) ++levels;
+
+    std::vector<PersonID> table(levels * people);
+    for (size_t i = 0; i < people; ++i) {
+        table[i] = parent(static_cast<PersonID>(i));
+    }
+    for (uint32_t level = 1; level < levels; ++level) {
+        const PersonID* below = table.data() + (level - 1) * people;
+        PersonID* here = table.data() + level * people;
+        for (size_t i = 0; i < people; ++i) {
+            here[i] = below[i] == NO_PERSON ? NO_PERSON : below[below[i]];
+        }
+    }
+
+    depths.assign(std::move(depth));
+    jumps.assign(std::move(table));
+}
+
+// Constructors
+LCAIndex::LCAIndex(const PersonStore& store) : m_people(store.size()) {
+    m_lines[0].build(m_people, [&](PersonID id) { return store.mother(id); });
+    m_lines[1].build(m_people, [&](PersonID id) { return store.father(id); });
+}
+
+LCAIndex::LCAIndex(size_t people, const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing)
+    : m_people(people), m_backing(std::move(backing)) {
+    for (int i = 0; i < 2; ++i) {
+        const auto& depths = sections[i == 0 ? MATERNAL_DEPTHS : PATERNAL_DEPTHS];
+        const auto& jumps = sections[i == 0 ? MATERNAL_JUMPS : PATERNAL_JUMPS];
+        m_lines[i].depths.view(static_cast<const uint32_t*>(depths.first), depths.second / sizeof(uint32_t));
+        m_lines[i].jumps.view(static_cast<const PersonID*>(jumps.first), jumps.second / sizeof(PersonID));
+        m_lines[i].levels = people == 0 ? 0 : static_cast<uint32_t>(jumps.second / sizeof(PersonID) / people);
+    }
+}
+
+// Queries
+PersonID LCAIndex::ancestor(PersonID id, uint32_t generations, PMod pmod) const {
+    const Line& line = this->line(pmod);
+    if (id == NO_PERSON || generations > line.depths[id]) return NO_PERSON;
+
+    for (uint32_t level = 0; generations != 0; ++level, generations >>= 1) {
+        if (generations & 1) id = line.jump(level, id, m_people);
+    }
+    return id;
+}
+
+/*
+Lift the deeper person to the other's depth. If that is the other person,
+they are the answer; otherwise lift both, from the longest jump down, as
+far as they can go without meeting. Their parents are then the answer (or
+both NO_PERSON, if the lines have different tops).
+*/
+PersonID LCAIndex::common(PersonID a, PersonID b, PMod pmod) const {
+    if (a == NO_PERSON || b == NO_PERSON) return NO_PERSON;
+
+    const Line& line = this->line(pmod);
+    uint32_t depthA = line.depths[a];
+    uint32_t depthB = line.depths[b];
+    if (depthA > depthB) a = ancestor(a, depthA - depthB, pmod);
+    if (depthB > depthA) b = ancestor(b, depthB - depthA, pmod);
+    if (a == b) return a;
+
+    for (uint32_t level = line.levels; level-- > 0;) {
+        PersonID upA = line.jump(level, a, m_people);
+        PersonID upB = line.jump(level, b, m_people);
+        if (upA != upB) {
+            a = upA;
+            b = upB;
+        }
+    }
+    return line.jump(0, a, m_people);
+}
+
+// Snapshots
+std::pair<const void*, size_t> LCAIndex::section(Section section) const {
+    switch (section) {
+        case MATERNAL_DEPTHS: return {m_lines[0].depths.data(), m_lines[0].depths.size() * sizeof(uint32_t)};
+        case MATERNAL_JUMPS:  return {m_lines[0].jumps.data(), m_lines[0].jumps.size() * sizeof(PersonID)};
+        case PATERNAL_DEPTHS: return {m_lines[1].depths.data(), m_lines[1].depths.size() * sizeof(uint32_t)};
+        case PATERNAL_JUMPS:  return {m_lines[1].jumps.data(), m_lines[1].jumps.size() * sizeof(PersonID)};
+        default:              return {nullptr, 0};
+    }
+}
+
+size_t LCAIndex::bytes() const {
+    size_t result = sizeof(*this);
+    for (const Line& line : m_lines) {
+        result += line.depths.bytes() + line.jumps.bytes();
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef LCAINDEX_H
+#define LCAINDEX_H
+
+#include "Column.h"
+#include "PersonStore.h"
+#include "Roles.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Nearest common ancestors along single parent lines, by binary lifting.
+//
+// Everyone's mother, mother's mother and so on make one line, and together
+// those lines form a forest; so do the fathers' lines. For each forest the
+// index keeps everyone's depth in it and their 2^k-th ancestor up it for
+// every k up to the deepest line, so two people's lowest common ancestor on
+// a line takes O(log depth) jumps: on the maternal line that is their most
+// recent common ancestor in the direct female line (as mitochondrial DNA
+// traces it), on the paternal line in the direct male line (Y-DNA).
+//
+// Anyone further back has two lineages, so in general the nearest common
+// ancestor is on neither line; GenePool::relationship() searches for it.
+//
+// The index is a snapshot of the store: rebuild it if the store changes.
+class LCAIndex {
+public:
+  // The arrays, in a fixed order, for snapshots.
+  enum Section : uint32_t {
+    MATERNAL_DEPTHS, MATERNAL_JUMPS, PATERNAL_DEPTHS, PATERNAL_JUMPS, SECTIONS
+  };
+
+private:
+  struct Line {
+    Column<uint32_t> depths;  // Ancestors above each person on the line
+    Column<PersonID> jumps;   // Level k of person i is jumps[k * people + i]
+    uint32_t levels = 0;
+
+    template <typename Parent>
+    void build(size_t people, Parent parent);
+    // Nobody's ancestors are nobody, which a damaged snapshot's depths can
+    // otherwise climb past
+    PersonID jump(uint32_t level, PersonID id, size_t people) const {
+      return id == NO_PERSON ? NO_PERSON : jumps[level * people + id];
+    }
+  };
+
+  // Member Variables
+  size_t m_people = 0;
+  Line   m_lines[2];  // Maternal, then paternal
+  std::shared_ptr<const void> m_backing;
+
+  const Line& line(PMod pmod) const { return m_lines[pmod == PMod::PATERNAL ? 1 : 0]; }
+
+public:
+  // O(n log depth) time and space.
+  explicit LCAIndex(const PersonStore& store);
+
+  // Run on arrays stored elsewhere, such as a mapped snapshot; sections[i]
+  // is the data for Section i. backing is held as long as the index is.
+  LCAIndex(size_t people, const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing);
+
+  // The nearest person on both a's and b's line (MATERNAL or PATERNAL),
+  // which may be a or b themselves, or NO_PERSON if the lines never meet.
+  PersonID common(PersonID a, PersonID b, PMod line) const;
+
+  // The person generations steps up id's line, or NO_PERSON.
+  PersonID ancestor(PersonID id, uint32_t generations, PMod line) const;
+
+  // How many people are above id on the line.
+  uint32_t depth(PersonID id, PMod line) const { return this->line(line).depths[id]; }
+
+  // Raw access to one array's bytes, for snapshots.
+  std::pair<const void*, size_t> section(Section section) const;
+
+  // Approximate heap footprint (arrays viewed from a snapshot are not counted).
+  size_t bytes() const;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "Loading.h"
+// Loading Member Functions
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Constructor
+MappedFile::MappedFile(const char* path, Access access) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0) {
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size == 0) {
+            m_open = true;
+        }
+        else {
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const char*>(data);
+                m_open = true;
+                advise(m_data, m_size, access);
+            }
+        }
+    }
+    ::close(fd);
+}
+
+// Destructor
+MappedFile::~MappedFile() {
+    if (m_data) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+// madvise() wants a page-aligned start, so widen the range down to one
+void MappedFile::advise(const void* first, size_t size, Access access) const {
+    if (m_data == nullptr || size == 0) return;
+    uintptr_t page  = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    uintptr_t start = reinterpret_cast<uintptr_t>(first) / page * page;
+    size += reinterpret_cast<uintptr_t>(first) - start;
+
+    int advice = access == Access::RANDOM ? MADV_RANDOM : access == Access::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_NORMAL;
+    ::madvise(reinterpret_cast<void*>(start), size, advice);
+}
+
+// Constructor
+DelimiterScanner::DelimiterScanner(const char* begin, const char* end)
+    : m_begin(begin), m_size(end - begin), m_block(0), m_mask(classify(begin, end - begin)) {}
+
+// Set bit i for every tab or newline in data[0 .. min(size, 64)).
+uint64_t DelimiterScanner::classify(const char* data, size_t size) {
+    uint64_t mask = 0;
+    if (size >= 64) {
+#if defined(__AVX2__)
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i nl  = _mm256_set1_epi8('\n');
+        for (int i = 0; i < 2; ++i) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32 * i));
+            __m256i hits  = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, tab), _mm256_cmpeq_epi8(bytes, nl));
+            mask |= uint64_t(uint32_t(_mm256_movemask_epi8(hits))) << (32 * i);
+        }
+        return mask;
+#elif defined(__SSE2__)
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i nl  = _mm_set1_epi8('\n');
+        for (int i = 0; i < 4; ++i) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i));
+            __m128i hits  = _mm_or_si128(_mm_cmpeq_epi8(bytes, tab), _mm_cmpeq_epi8(bytes, nl));
+            mask |= uint64_t(uint32_t(_mm_movemask_epi8(hits))) << (16 * i);
+        }
+        return mask;
+#else
+        size = 64;
+#endif
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] == '\t' || data[i] == '\n') {
+            mask |= uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
+const char* DelimiterScanner::next() {
+    while (m_mask == 0) {
+        m_block += 64;
+        if (m_block >= m_size) {
+            m_block = m_size;
+            return m_begin + m_size;
+        }
+        m_mask = classify(m_begin + m_block, m_size - m_block);
+    }
+
+    size_t offset = m_block + __builtin_ctzll(m_mask);
+    m_mask &= m_mask - 1;
+    return m_begin + offset;
+}
+
+std::vector<const char*> splitLines(const char* begin, const char* end, size_t parts) {
+    std::vector<const char*> bounds(1, begin);
+    size_t step = (end - begin) / (parts ? parts : 1) + 1;
+
+    const char* cursor = begin;
+    while (end - cursor > static_cast<ptrdiff_t>(step)) {
+        const void* newline = std::memchr(cursor + step, '\n', end - cursor - step);
+        if (!newline) break;
+        cursor = static_cast<const char*>(newline) + 1;
+        bounds.push_back(cursor);
+    }
+
+    if (bounds.back() != end) {
+        bounds.push_back(end);
+    }
+    return bounds;
+}
+
+/*
+Ingestion runs in phases, each parallel except for prefix sums:
+ 1. count the rows and name bytes in each chunk, giving each chunk its
+    first ID and the offset of its first name;
+ 2. parse each chunk again, writing names, genders and name offsets
+    straight into the store;
+ 3. index the names (see indexNames). For IN_ORDER, remember who each name
+    pointed at before (previous), to resolve references to earlier rows;
+ 4. parse each chunk a third time and resolve the parent names.
+Re-scanning the text is cheaper than keeping every field of every row.
+*/
+void ingest(const char* data, size_t size, LoadMode mode, PersonStore& store, NameIndex& index) {
+    ingest(std::vector<std::string_view>(1, std::string_view(data, size)), mode, store, index);
+}
+
+// Each shard is split into chunks on its own; chunks never span shards
+void ingest(const std::vector<std::string_view>& shards, LoadMode mode, PersonStore& store, NameIndex& index) {
+    size_t total = 0;
+    for (std::string_view shard : shards) total += shard.size();
+
+    std::vector<const char*> begins;
+    std::vector<const char*> ends;
+    for (std::string_view shard : shards) {
+        size_t parts = total < (1 << 20) ? 1 : workerCount() * 4 * shard.size() / total + 1;
+        std::vector<const char*> bounds = splitLines(shard.data(), shard.data() + shard.size(), parts);
+        for (size_t b = 0; b + 1 < bounds.size(); ++b) {
+            begins.push_back(bounds[b]);
+            ends.push_back(bounds[b + 1]);
+        }
+    }
+    size_t chunks = begins.size();
+
+    std::vector<size_t> first(chunks + 1, 0);
+    std::vector<size_t> bytes(chunks + 1, 0);
+    parallelFor(chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            forEachRow(begins[c], ends[c], [&](const std::string_view* fields) {
+                first[c + 1] += 1;
+                bytes[c + 1] += fields[0].size();
+            });
+        }
+    });
+    for (size_t c = 0; c < chunks; ++c) {
+        first[c + 1] += first[c];
+        bytes[c + 1] += bytes[c];
+    }
+
+    size_t count = first[chunks];
+    if (count >= NO_PERSON) {
+        throw std::runtime_error("Too many people in database.");
+    }
+
+    store.resize(count, bytes[chunks]);
+    parallelFor(chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            PersonID id = static_cast<PersonID>(first[c]);
+            uint64_t offset = bytes[c];
+            forEachRow(begins[c], ends[c], [&](const std::string_view* fields) {
+                store.set(id, offset, fields[0], fields[1] == "male" ? Gender::MALE : Gender::FEMALE);
+                offset += fields[0].size();
+                ++id;
+            });
+        }
+    });
+
+    std::vector<PersonID> previous;
+    indexNames(store, index, mode == LoadMode::IN_ORDER ? &previous : nullptr);
+
+    auto resolve = [&](std::string_view name, PersonID child) {
+        if (name == "???") return NO_PERSON;
+        PersonID id = index.find(name);
+        if (mode == LoadMode::IN_ORDER) {
+            while (id != NO_PERSON && id >= child) id = previous[id];
+        }
+        return id;
+    };
+
+    parallelFor(chunks, 1, [&](size_t lo, size_t hi) {
+        for (size_t c = lo; c < hi; ++c) {
+            PersonID id = static_cast<PersonID>(first[c]);
+            forEachRow(begins[c], ends[c], [&](const std::string_view* fields) {
+                store.setParents(id, resolve(fields[2], id), resolve(fields[3], id));
+                ++id;
+            });
+        }
+    });
+
+    store.buildChildren();
+    if (mode == LoadMode::ANY_ORDER) {
+        PersonID cycle = store.findCycle();
+        if (cycle != NO_PERSON) {
+            throw std::runtime_error("Family tree has a cycle at or above " + std::string(store.name(cycle)) + ".");
+        }
+    }
+}
+
+/*
+Hash every name in parallel, then fill the index with one thread per range
+of shards, each walking all IDs in order so that later rows win.
+*/
+void indexNames(const PersonStore& store, NameIndex& index, std::vector<PersonID>* previous) {
+    size_t count = store.size();
+    std::vector<uint64_t> hashes(count);
+    parallelFor(count, 1 << 16, [&](size_t lo, size_t hi) {
+        for (size_t id = lo; id < hi; ++id) {
+            hashes[id] = NameIndex::hash(store.name(static_cast<PersonID>(id)));
+        }
+    });
+
+    std::vector<size_t> perShard(NameIndex::SHARDS, 0);
+    for (uint64_t hash : hashes) {
+        ++perShard[NameIndex::shard(hash)];
+    }
+    index.reserve(*std::max_element(perShard.begin(), perShard.end()));
+
+    if (previous) previous->assign(count, NO_PERSON);
+    parallelFor(NameIndex::SHARDS, count < (1 << 16) ? NameIndex::SHARDS : 1, [&](size_t lo, size_t hi) {
+        for (size_t id = 0; id < count; ++id) {
+            size_t shard = NameIndex::shard(hashes[id]);
+            if (shard < lo || shard >= hi) continue;
+
+            PersonID before = index.assign(store.name(static_cast<PersonID>(id)), hashes[id], static_cast<PersonID>(id));
+            if (previous) (*previous)[id] = before;
+        }
+    });
+}
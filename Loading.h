@@ -0,0 +1,119 @@
+#ifndef LOADING_H
+#define LOADING_H
+
+#include "NameIndex.h"
+#include "PersonStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// How parent names in a TSV file are resolved.
+enum class LoadMode {
+  IN_ORDER,   // Parents must be listed before their children
+  ANY_ORDER   // Rows may come in any order and any shard; parents are linked in a second pass
+};
+
+// How a mapped range is going to be read, for the OS's readahead.
+enum class Access {
+  NORMAL,      // Some readahead around each page touched
+  SEQUENTIAL,  // Front to back, once
+  RANDOM       // Scattered reads; no readahead
+};
+
+// A read-only memory mapping of a whole file. Pages are read in as they are
+// touched and, being clean, may be dropped again whenever memory is short,
+// so a mapping can be much larger than RAM.
+class MappedFile {
+  // Member Variables
+  const char* m_data = nullptr;
+  size_t      m_size = 0;
+  bool        m_open = false;
+
+public:
+  MappedFile(const char* path, Access access = Access::NORMAL);
+  ~MappedFile();
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator = (const MappedFile& other) = delete;
+
+  // Tell the OS how [first, first + size) will be read. The constructor
+  // advises the whole file; parsing wants SEQUENTIAL, but a snapshot should
+  // not be, as a SEQUENTIAL fault reads far ahead.
+  void advise(const void* first, size_t size, Access access) const;
+
+  bool is_open() const { return m_open; }
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+};
+
+// Finds the tabs and newlines in a buffer, in order.
+// The buffer is classified 64 bytes at a time into a bitmask (with AVX2 or
+// SSE2 compares where available, a byte loop otherwise) so that short TSV
+// fields cost one bit-scan each instead of a byte-by-byte search.
+class DelimiterScanner {
+  // Member Variables
+  const char* m_begin;
+  size_t      m_size;
+  size_t      m_block;
+  uint64_t    m_mask;
+
+  static uint64_t classify(const char* data, size_t size);
+
+public:
+  DelimiterScanner(const char* begin, const char* end);
+
+  // The next tab or newline, or the end of the buffer.
+  const char* next();
+};
+
+// Call row(fields) for each TSV row of name, gender, mother and father in
+// [begin, end). Lines that are empty or start with '#' are skipped, missing
+// fields read as empty, and extra fields are ignored. Fields are sliced
+// straight out of the buffer, so nothing is copied.
+template <typename Row>
+void forEachRow(const char* begin, const char* end, Row row) {
+  DelimiterScanner scanner(begin, end);
+
+  const char* cursor = begin;
+  while (cursor < end) {
+    const char* line = cursor;
+    std::string_view fields[4];
+    int count = 0;
+
+    while (true) {
+      const char* delimiter = scanner.next();
+      if (count < 4) {
+        fields[count++] = std::string_view(cursor, delimiter - cursor);
+      }
+      cursor = delimiter + 1;
+      if (delimiter == end || *delimiter == '\n') break;
+    }
+
+    if (cursor - line == 1 || *line == '#') continue;
+    row(fields);
+  }
+}
+
+// Split a buffer into about parts pieces that each end on a line boundary.
+// Returns the parts + 1 boundaries (fewer for small buffers).
+std::vector<const char*> splitLines(const char* begin, const char* end, size_t parts);
+
+// Parse a TSV buffer into an empty store and index, on all cores.
+// The buffer is split at line boundaries and each piece is parsed on its own
+// thread; IDs still follow file order, so the result is the same as a
+// sequential load. With IN_ORDER, a parent name refers to the latest person
+// of that name above the row; with ANY_ORDER, to the last one in the file,
+// and files containing cycles are rejected.
+void ingest(const char* data, size_t size, LoadMode mode, PersonStore& store, NameIndex& index);
+
+// The same over several buffers (such as the shards of one data set), read
+// as if they were one file in the order given.
+void ingest(const std::vector<std::string_view>& shards, LoadMode mode, PersonStore& store, NameIndex& index);
+
+// Fill an empty index from a loaded store, on all cores. Later IDs win a
+// shared name. If previous is given, it is filled with the ID each name
+// pointed at before (or NO_PERSON).
+void indexNames(const PersonStore& store, NameIndex& index, std::vector<PersonID>* previous);
+
+#endif
@@ -0,0 +1,280 @@
+#include "NameIndex.h"
+// NameIndex Member Functions
+#include <algorithm>
+#include <stdexcept>
+
+static const uint32_t SINGLE    = 0x80000000;  // Bucket holds a slot, not a seed
+static const uint32_t MAX_SEED  = 1 << 24;
+
+// Scatter the bits of a 64-bit value (MurmurHash3's finalizer)
+static uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+// Map 32 random bits onto [0, range) without a division
+static size_t reduce(uint32_t bits, size_t range) {
+    return static_cast<size_t>((static_cast<uint64_t>(bits) * range) >> 32);
+}
+
+static size_t bucketOf(uint64_t hash, size_t buckets) {
+    return reduce(static_cast<uint32_t>(hash), buckets);
+}
+
+static size_t slotOf(uint64_t hash, uint32_t seed, size_t slots) {
+    return reduce(static_cast<uint32_t>(mix(hash ^ (seed * 0x9E3779B97F4A7C15ull)) >> 32), slots);
+}
+
+// Constructor
+NameIndex::NameIndex(const PersonStore& store) : m_store(&store) {}
+
+// 64-bit FNV-1a, finalized so that every bit depends on every byte
+uint64_t NameIndex::hash(std::string_view name) {
+    uint64_t result = 14695981039346656037ull;
+    for (char c : name) {
+        result ^= static_cast<unsigned char>(c);
+        result *= 1099511628211ull;
+    }
+    return mix(result);
+}
+
+// Keep each region at most half full, so probes stay short
+void NameIndex::reserve(size_t perShard) {
+    m_regionBits = 1;
+    while ((size_t(1) << m_regionBits) < perShard * 2) {
+        ++m_regionBits;
+    }
+
+    m_table.assign(SHARDS << m_regionBits, Slot{NO_PERSON, 0});
+    m_fills.assign(SHARDS, 0);
+    m_perfect = false;
+    m_buckets = Column<uint32_t>();
+    m_slots = Column<PersonID>();
+    m_backing.reset();
+}
+
+PersonID NameIndex::assign(std::string_view name, uint64_t hash, PersonID id) {
+    size_t mask = (size_t(1) << m_regionBits) - 1;
+    Slot* region = m_table.data() + (shard(hash) << m_regionBits);
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Slot& slot = region[i];
+        if (slot.id == NO_PERSON) {
+            slot = Slot{id, tag};
+            ++m_fills[shard(hash)];
+            return NO_PERSON;
+        }
+        if (slot.tag == tag && m_store->name(slot.id) == name) {
+            PersonID previous = slot.id;
+            slot.id = id;
+            return previous;
+        }
+    }
+}
+
+PersonID NameIndex::insert(std::string_view name, PersonID id) {
+    uint64_t value = hash(name);
+    if (m_perfect || m_table.empty() || (m_fills[shard(value)] + 1) * 2 > (size_t(1) << m_regionBits)) {
+        rehash(1);
+    }
+    return assign(name, value, id);
+}
+
+/*
+Linear probing without tombstones: after emptying a slot, pull back any
+later name in the same run that would no longer be found, i.e. one whose
+home slot is not cyclically within (emptied slot, its own slot].
+*/
+bool NameIndex::erase(std::string_view name, PersonID id) {
+    if (m_perfect) rehash(0);
+    if (m_table.empty()) return false;
+
+    uint64_t value = hash(name);
+    size_t mask = (size_t(1) << m_regionBits) - 1;
+    Slot* region = m_table.data() + (shard(value) << m_regionBits);
+
+    size_t hole = value & mask;
+    while (region[hole].id != id) {
+        if (region[hole].id == NO_PERSON) return false;
+        hole = (hole + 1) & mask;
+    }
+
+    for (size_t i = (hole + 1) & mask; region[i].id != NO_PERSON; i = (i + 1) & mask) {
+        size_t home = hash(m_store->name(region[i].id)) & mask;
+        bool stays = hole < i ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!stays) {
+            region[hole] = region[i];
+            hole = i;
+        }
+    }
+    region[hole] = Slot{NO_PERSON, 0};
+    --m_fills[shard(value)];
+    return true;
+}
+
+// Move every name into a fresh table with room for at least extra more per region, doubled
+void NameIndex::rehash(size_t extra) {
+    std::vector<std::pair<uint64_t, PersonID>> keys;
+    each([&](PersonID id) {
+        keys.emplace_back(hash(m_store->name(id)), id);
+    });
+
+    std::vector<size_t> perShard(SHARDS, 0);
+    for (const auto& key : keys) {
+        ++perShard[shard(key.first)];
+    }
+    reserve(2 * (*std::max_element(perShard.begin(), perShard.end()) + extra));
+    for (const auto& key : keys) {
+        assign(m_store->name(key.second), key.first, key.second);
+    }
+}
+
+PersonID NameIndex::find(std::string_view name) const {
+    uint64_t value = hash(name);
+    return m_perfect ? findPerfect(name, value) : findProbing(name, value);
+}
+
+PersonID NameIndex::findProbing(std::string_view name, uint64_t hash) const {
+    if (m_table.empty()) return NO_PERSON;
+
+    size_t mask = (size_t(1) << m_regionBits) - 1;
+    const Slot* region = m_table.data() + (shard(hash) << m_regionBits);
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = region[i];
+        if (slot.id == NO_PERSON) return NO_PERSON;
+        if (slot.tag == tag && m_store->name(slot.id) == name) return slot.id;
+    }
+}
+
+/*
+The arrays may come straight from a file, so a damaged bucket or slot must
+not send us out of bounds; it just fails to match.
+*/
+PersonID NameIndex::findPerfect(std::string_view name, uint64_t hash) const {
+    if (m_buckets.size() == 0) return NO_PERSON;
+
+    uint32_t bucket = m_buckets[bucketOf(hash, m_buckets.size())];
+    if (bucket == 0) return NO_PERSON;
+
+    size_t slot = (bucket & SINGLE) ? bucket & ~SINGLE : slotOf(hash, bucket, m_slots.size());
+    if (slot >= m_slots.size()) return NO_PERSON;
+
+    PersonID id = m_slots[slot];
+    if (id >= m_store->size() || m_store->name(id) != name) return NO_PERSON;
+    return id;
+}
+
+/*
+Hash and displace (CHD). Names are spread over about n/3 buckets. Buckets
+are placed largest first: each gets the first seed that sends all of its
+names to distinct free slots. Buckets with a single name are placed last
+and simply take the next free slot, which is what lets every slot be used.
+*/
+NameIndex NameIndex::perfect() const {
+    std::vector<std::pair<uint64_t, PersonID>> keys;
+    each([&](PersonID id) {
+        keys.emplace_back(hash(m_store->name(id)), id);
+    });
+
+    size_t count = keys.size();
+    if (count >= SINGLE) {
+        throw std::runtime_error("Too many names for a perfect hash.");
+    }
+
+    NameIndex result(*m_store);
+    result.m_perfect = true;
+    if (count == 0) return result;
+
+    // Counting sort by bucket: bucket b's names end up in
+    // sorted[first[b] .. first[b + 1]).
+    size_t bucketCount = count / 3 + 1;
+    std::vector<size_t> first(bucketCount + 1, 0);
+    for (const auto& key : keys) {
+        ++first[bucketOf(key.first, bucketCount) + 1];
+    }
+    for (size_t b = 0; b < bucketCount; ++b) {
+        first[b + 1] += first[b];
+    }
+
+    std::vector<std::pair<uint64_t, PersonID>> sorted(count);
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (const auto& key : keys) {
+        sorted[fill[bucketOf(key.first, bucketCount)]++] = key;
+    }
+    keys.swap(sorted);
+
+    std::vector<uint32_t> order(bucketCount);
+    for (size_t b = 0; b < bucketCount; ++b) {
+        order[b] = static_cast<uint32_t>(b);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return first[a + 1] - first[a] > first[b + 1] - first[b];
+    });
+
+    std::vector<uint32_t> buckets(bucketCount, 0);
+    std::vector<PersonID> slots(count, NO_PERSON);
+    std::vector<size_t> placed;
+    size_t nextFree = 0;
+
+    for (uint32_t b : order) {
+        size_t size = first[b + 1] - first[b];
+        if (size == 0) break;
+
+        if (size == 1) {
+            while (slots[nextFree] != NO_PERSON) ++nextFree;
+            slots[nextFree] = keys[first[b]].second;
+            buckets[b] = SINGLE | static_cast<uint32_t>(nextFree);
+            continue;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < MAX_SEED; ++seed) {
+            placed.clear();
+            for (size_t k = first[b]; k < first[b + 1]; ++k) {
+                size_t slot = slotOf(keys[k].first, seed, count);
+                if (slots[slot] != NO_PERSON || std::find(placed.begin(), placed.end(), slot) != placed.end()) break;
+                placed.push_back(slot);
+            }
+            if (placed.size() == size) break;
+        }
+        if (seed == MAX_SEED) {
+            throw std::runtime_error("Cannot build a perfect hash of the names.");
+        }
+
+        for (size_t k = 0; k < size; ++k) {
+            slots[placed[k]] = keys[first[b] + k].second;
+        }
+        buckets[b] = seed;
+    }
+
+    result.m_buckets.assign(std::move(buckets));
+    result.m_slots.assign(std::move(slots));
+    return result;
+}
+
+std::pair<const void*, size_t> NameIndex::section(Section section) const {
+    switch (section) {
+        case BUCKETS: return {m_buckets.data(), m_buckets.size() * sizeof(uint32_t)};
+        case SLOTS:   return {m_slots.data(), m_slots.size() * sizeof(PersonID)};
+        default:      return {nullptr, 0};
+    }
+}
+
+size_t NameIndex::bytes() const {
+    return m_table.capacity() * sizeof(Slot) + m_fills.capacity() * sizeof(uint32_t) + m_buckets.bytes() + m_slots.bytes();
+}
+
+void NameIndex::view(const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing) {
+    m_table = std::vector<Slot>();
+    m_perfect = true;
+    m_buckets.view(static_cast<const uint32_t*>(sections[BUCKETS].first), sections[BUCKETS].second / sizeof(uint32_t));
+    m_slots.view(static_cast<const PersonID*>(sections[SLOTS].first), sections[SLOTS].second / sizeof(PersonID));
+    m_backing = std::move(backing);
+}
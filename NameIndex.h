@@ -0,0 +1,111 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include "Column.h"
+#include "PersonStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Maps names to person IDs. Names are not copied: the index holds IDs and
+// compares against the names in the store.
+//
+// While loading, the index is an open-addressing table split into regions
+// by the top bits of the name's hash, so separate threads can fill separate
+// regions at the same time. Snapshots carry a minimal perfect hash instead
+// (see perfect()), which answers find() with one bucket read, one slot read
+// and one name comparison, and is used in place from the mapped file.
+class NameIndex {
+public:
+  static const size_t SHARDS = 64;
+
+  // The perfect hash's arrays, in a fixed order, for snapshots.
+  enum Section : uint32_t {
+    BUCKETS, SLOTS, SECTIONS
+  };
+
+private:
+  struct Slot {
+    PersonID id;
+    uint32_t tag;  // High hash bits, to skip most name comparisons
+  };
+
+  // Member Variables
+  const PersonStore* m_store;
+
+  // Open addressing: SHARDS regions of 2^m_regionBits slots each.
+  std::vector<Slot> m_table;
+  std::vector<uint32_t> m_fills;  // Names in each region
+  unsigned m_regionBits = 0;
+
+  // Minimal perfect hash: a bucket holds either a seed for placing its
+  // names, or (top bit set) the slot of its only name. Slot i holds an ID.
+  bool m_perfect = false;
+  Column<uint32_t> m_buckets;
+  Column<PersonID> m_slots;
+  std::shared_ptr<const void> m_backing;
+
+  // Helper Functions
+  PersonID findProbing(std::string_view name, uint64_t hash) const;
+  PersonID findPerfect(std::string_view name, uint64_t hash) const;
+  void rehash(size_t extra);
+
+public:
+  explicit NameIndex(const PersonStore& store);
+
+  static uint64_t hash(std::string_view name);
+  static size_t shard(uint64_t hash) { return hash >> 58; }
+
+  // Empty the index and make room for up to perShard names in every shard.
+  void reserve(size_t perShard);
+
+  // Point name at id. Returns whoever it pointed at before, or NO_PERSON.
+  // Needs reserve() first; different threads may assign in different shards.
+  PersonID assign(std::string_view name, uint64_t hash, PersonID id);
+
+  // Point name at id, or stop pointing name at id (if it does), on an index
+  // of either kind. These are for editing a loaded pool one person at a
+  // time: a full region (or a perfect hash) is first rebuilt as a larger
+  // table, so they take O(1) amortized time. insert() returns whoever name
+  // pointed at before, or NO_PERSON.
+  PersonID insert(std::string_view name, PersonID id);
+  bool erase(std::string_view name, PersonID id);
+
+  // Return the ID for a name, or NO_PERSON.
+  PersonID find(std::string_view name) const;
+
+  // A minimal perfect hash over the same names, for snapshots.
+  NameIndex perfect() const;
+  bool probing() const { return !m_perfect; }
+
+  // Raw access to the perfect hash's arrays, for snapshots.
+  std::pair<const void*, size_t> section(Section section) const;
+
+  // Run on a perfect hash stored elsewhere, as PersonStore::view() does.
+  void view(const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing);
+
+  // Heap bytes held by the index (a viewed perfect hash holds none). The
+  // probing table keeps every region at most half full, so it takes about
+  // three times what a perfect hash over the same names does.
+  size_t bytes() const;
+
+  // Call visit(id) for every indexed person.
+  template <typename Visit>
+  void each(Visit visit) const {
+    if (m_perfect) {
+      for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (m_slots[i] < m_store->size()) visit(m_slots[i]);
+      }
+    }
+    else {
+      for (const Slot& slot : m_table) {
+        if (slot.id != NO_PERSON) visit(slot.id);
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use for bulk work.
+inline unsigned workerCount() {
+  unsigned count = std::thread::hardware_concurrency();
+  return count == 0 ? 1 : count;
+}
+
+// Call body(first, last) over disjoint chunks of [0, count) on up to
+// workerCount() threads. Chunks smaller than grain are not worth a thread,
+// so small inputs run inline on the calling thread.
+template <typename Body>
+void parallelFor(size_t count, size_t grain, Body body) {
+  size_t threads = std::min<size_t>(workerCount(), (count + grain - 1) / std::max<size_t>(grain, 1));
+  if (threads <= 1) {
+    body(size_t(0), count);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t chunk = (count + threads - 1) / threads;
+  for (size_t first = chunk; first < count; first += chunk) {
+    workers.emplace_back(body, first, std::min(count, first + chunk));
+  }
+  body(size_t(0), std::min(count, chunk));
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// Like parallelFor, but workers take chunks of grain items from a shared
+// counter as they finish, so uneven work still keeps every thread busy.
+template <typename Body>
+void parallelForDynamic(size_t count, size_t grain, Body body) {
+  grain = std::max<size_t>(grain, 1);
+  size_t threads = std::min<size_t>(workerCount(), (count + grain - 1) / grain);
+  std::atomic<size_t> next(0);
+
+  auto work = [&]() {
+    for (;;) {
+      size_t first = next.fetch_add(grain);
+      if (first >= count) return;
+      body(first, std::min(count, first + grain));
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+#endif
@@ -1,284 +1,301 @@
 #include "Parsing.h"
+#include "Tracing.h"
 
 #include <algorithm>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 // This file provides query parsing and execution.
-// You can edit it if you want, but you shouldn't need to.
-// Gradescope will use the original version.
+//
+// Queries can chain relationships and combine them:
+//
+//   Alice's maternal cousins' sons
+//   Alice's descendants & Bob's descendants
+//   (Alice's children | Bob's children) - Carol's grandchildren
+//
+// A possessive on a relationship ("cousins'", "father's") means another
+// relationship follows. & (both) binds tighter than | (either) and
+// - (but not), which group left to right; parentheses group anything.
 
 
-// Helper function that throws an error if a read fails:
-void read_term(std::istream& stream, std::string& term) {
-  if(!(stream >> term)) {
-    throw std::invalid_argument("Too few terms in query.");
+// Helper function that looks up a relationship word:
+Relationship read_relationship(const std::string& word) {
+  Relationship relationship;
+  if(!parseRelationship(word, relationship)) {
+    throw std::invalid_argument("Unknown relationship: " + word);
   }
-}
 
-// Construct a query by parsing text:
-Query::Query(const std::string& text) {
-  std::istringstream stream(text);
+  return relationship;
+}
 
-  mPMod = PMod::ANY;
-  mSMod = SMod::ANY;
+// Helper function that removes a trailing "'s" or "'" from a word:
+bool strip_possessive(std::string& word) {
+  size_t length = word.length();
+  if(length > 2 && word.compare(length - 2, 2, "'s") == 0) {
+    word.erase(length - 2);
+    return true;
+  }
+  if(length > 1 && word[length - 1] == '\'') {
+    word.erase(length - 1);
+    return true;
+  }
 
-  std::string term;
-  read_term(stream, mName);
+  return false;
+}
 
-  // This is a special case:
-  if(mName == "everyone") {
-    if(stream >> term) {
-      throw std::invalid_argument("Too many terms in query.");
-    }
+// Recursive descent over the words of a query:
+class QueryParser {
+  std::vector<std::string> mTerms;
+  size_t      mNext = 0;
+  Expression& mExpression;
 
-    mName = "Everyone";
-    mRelationship = "everyone";
-    return;
+  bool is_operator(const std::string& term) const {
+    return term == "&" || term == "|" || term == "-" || term == ")";
   }
 
-  // Translate underscores to spaces and remove posessives:
-  std::replace(mName.begin(), mName.end(), '_', ' ');
-
-  size_t pos = mName.length() - 2;
-  if(mName.find("'s", pos) == pos) {
-    mName = mName.substr(0, pos);
+  bool done() const {
+    return mNext == mTerms.size();
   }
 
-  read_term(stream, term);
-  if(term == "maternal") {
-    mPMod = PMod::MATERNAL;
-    read_term(stream, term);
-  }
-  else if(term == "paternal") {
-    mPMod = PMod::PATERNAL;
-    read_term(stream, term);
+  const std::string& peek() const {
+    return mTerms[mNext];
   }
 
-  if(term == "full") {
-    mSMod = SMod::FULL;
-    read_term(stream, term);
-  }
-  else if(term == "half") {
-    mSMod = SMod::HALF;
-    read_term(stream, term);
+  // Throws an error if a read fails:
+  std::string read_term() {
+    if(done()) {
+      throw std::invalid_argument("Too few terms in query.");
+    }
+
+    return mTerms[mNext++];
   }
 
-  mRelationship = term;
-  if(stream >> term) {
-    throw std::invalid_argument("Too many terms in query.");
+  // Whatever follows a finished chain has to be an operator:
+  void expect_end_of_chain() const {
+    if(!done() && !is_operator(peek())) {
+      throw std::invalid_argument("Too many terms in query.");
+    }
   }
 
-  validate();
-}
+  // One or more relationships, each a possessive of the last:
+  Expression::Node read_hops(Expression::Node node) {
+    while(true) {
+      PMod pmod = PMod::ANY;
+      SMod smod = SMod::ANY;
 
-// Construct a query directly:
-Query::Query(const std::string& name, const std::string& relationship, PMod pmod, SMod smod) {
-  this->mName         = name;
-  this->mRelationship = relationship;
-  this->mPMod         = pmod;
-  this->mSMod         = smod;
+      std::string term = read_term();
+      if(term == "maternal") {
+        pmod = PMod::MATERNAL;
+        term = read_term();
+      }
+      else if(term == "paternal") {
+        pmod = PMod::PATERNAL;
+        term = read_term();
+      }
 
-  validate();
-}
+      if(term == "full") {
+        smod = SMod::FULL;
+        term = read_term();
+      }
+      else if(term == "half") {
+        smod = SMod::HALF;
+        term = read_term();
+      }
 
-// Run a query against a gene pool:
-std::set<Person*> Query::run(const GenePool& pool) const {
-  if(mRelationship == "everyone") {
-    return pool.everyone();
-  }
+      bool more = strip_possessive(term);
+      if(!more) {
+        expect_end_of_chain();
+      }
 
-  Person* person = pool.find(mName);
-  if(person == nullptr) {
-    throw std::invalid_argument("No such person: " + mName);
+      node = mExpression.hop(node, read_relationship(term), pmod, smod);
+      if(!more) {
+        return node;
+      }
+    }
   }
 
-  if(mRelationship == "ancestors") {
-    return person->ancestors(mPMod);
-  }
-  else if(mRelationship == "aunts") {
-    return person->aunts(mPMod, mSMod);
-  }
-  else if(mRelationship == "brothers") {
-    return person->brothers(mPMod, mSMod);
-  }
-  else if(mRelationship == "children") {
-    return person->children();
-  }
-  else if(mRelationship == "cousins") {
-    return person->cousins(mPMod, mSMod);
-  }
-  else if(mRelationship == "daughters") {
-    return person->daughters();
-  }
-  else if(mRelationship == "descendants") {
-    return person->descendants();
-  }
-  else if(mRelationship == "father") {
-    Person* father = person->father();
-    std::set<Person*> result;
-    if(father != nullptr) {
-      result.insert(father);
+  // A name (or everyone) and the relationships that follow it:
+  Expression::Node read_chain() {
+    std::string name = read_term();
+
+    // This is a special case:
+    if(name == "everyone") {
+      expect_end_of_chain();
+      return mExpression.everyone();
+    }
+    if(name == "everyone's" || name == "everyone'") {
+      return read_hops(mExpression.everyone());
     }
 
-    return result;
-  }
-  else if(mRelationship == "grandchildren") {
-    return person->grandchildren();
-  }
-  else if(mRelationship == "granddaughters") {
-    return person->granddaughters();
-  }
-  else if(mRelationship == "grandfathers") {
-    return person->grandfathers(mPMod);
-  }
-  else if(mRelationship == "grandmothers") {
-    return person->grandmothers(mPMod);
-  }
-  else if(mRelationship == "grandparents") {
-    return person->grandparents(mPMod);
+    // Translate underscores to spaces and remove posessives:
+    std::replace(name.begin(), name.end(), '_', ' ');
+    strip_possessive(name);
+    return read_hops(mExpression.person(name));
   }
-  else if(mRelationship == "grandsons") {
-    return person->grandsons();
-  }
-  else if(mRelationship == "mother") {
-    Person* mother = person->mother();
-    std::set<Person*> result;
-    if(mother != nullptr) {
-      result.insert(mother);
+
+  Expression::Node read_operand() {
+    if(!done() && peek() == "(") {
+      ++mNext;
+      Expression::Node node = read_union();
+      if(done() || read_term() != ")") {
+        throw std::invalid_argument("Unbalanced parentheses in query.");
+      }
+
+      expect_end_of_chain();
+      return node;
     }
 
-    return result;
-  }
-  else if(mRelationship == "nephews") {
-    return person->nephews(mPMod, mSMod);
-  }
-  else if(mRelationship == "nieces") {
-    return person->nieces(mPMod, mSMod);
-  }
-  else if(mRelationship == "parents") {
-    return person->parents(mPMod);
-  }
-  else if(mRelationship == "siblings") {
-    return person->siblings(mPMod, mSMod);
+    return read_chain();
   }
-  else if(mRelationship == "sisters") {
-    return person->sisters(mPMod, mSMod);
+
+  Expression::Node read_intersection() {
+    Expression::Node node = read_operand();
+    while(!done() && peek() == "&") {
+      ++mNext;
+      node = mExpression.combine(Expression::Kind::AND, node, read_operand());
+    }
+
+    return node;
   }
-  else if(mRelationship == "sons") {
-    return person->sons();
+
+  Expression::Node read_union() {
+    Expression::Node node = read_intersection();
+    while(!done() && (peek() == "|" || peek() == "-")) {
+      Expression::Kind kind = read_term() == "|" ? Expression::Kind::OR : Expression::Kind::MINUS;
+      node = mExpression.combine(kind, node, read_intersection());
+    }
+
+    return node;
   }
-  else if(mRelationship == "uncles") {
-    return person->uncles(mPMod, mSMod);
+
+public:
+  // Split the text into words, with parentheses as words of their own:
+  QueryParser(const std::string& text, Expression& expression): mExpression(expression) {
+    std::istringstream stream(text);
+    std::string word;
+    while(stream >> word) {
+      size_t first = 0;
+      size_t last  = word.length();
+      while(first < last && word[first] == '(') {
+        mTerms.push_back("(");
+        ++first;
+      }
+
+      size_t closing = 0;
+      while(last > first && word[last - 1] == ')') {
+        ++closing;
+        --last;
+      }
+
+      if(last > first) {
+        mTerms.push_back(word.substr(first, last - first));
+      }
+      mTerms.insert(mTerms.end(), closing, ")");
+    }
   }
-  else {
-    throw std::invalid_argument("Unknown relationship: " + mRelationship);
+
+  Expression::Node parse() {
+    Expression::Node node = read_union();
+    if(!done()) {
+      throw std::invalid_argument(peek() == ")" ? "Unbalanced parentheses in query." : "Too many terms in query.");
+    }
+
+    return node;
   }
+};
+
+// Construct a query by parsing text:
+Query::Query(const std::string& text) {
+  Trace::Span span;
+  QueryParser parser(text, mExpression);
+  mExpression.setRoot(parser.parse());
+  span.done(Trace::Kind::PARSE, 0);
 }
 
-void Query::validate(bool allow_pmod, bool allow_smod) const {
-  if(allow_pmod == false && mPMod != PMod::ANY) {
-    throw std::invalid_argument("Parent modifier is not allowed in " + mRelationship + " queries.");
-  }
+// Construct a query directly:
+Query::Query(const std::string& name, const std::string& relationship, PMod pmod, SMod smod) {
+  Expression::Node node = mExpression.person(name);
+  mExpression.setRoot(mExpression.hop(node, read_relationship(relationship), pmod, smod));
+}
 
-  if(allow_smod == false && mSMod != SMod::ANY) {
-    throw std::invalid_argument("Sibling modifier is not allowed in " + mRelationship + " queries.");
-  }
+// Run a query against a gene pool:
+PersonSet Query::run(const GenePool& pool) const {
+  Trace::Span span;
+  PersonSet result = mExpression.run(pool);
+  span.done(Trace::Kind::QUERY, result.size());
+  return result;
 }
 
-void Query::validate() const {
-  if(mRelationship == "ancestors") {
-    validate(true, false);
-  }
-  else if(mRelationship == "aunts") {
-    validate(true, true);
-  }
-  else if(mRelationship == "brothers") {
-    validate(true, true);
-  }
-  else if(mRelationship == "children") {
-    validate(false, false);
-  }
-  else if(mRelationship == "cousins") {
-    validate(true, true);
-  }
-  else if(mRelationship == "daughters") {
-    validate(false, false);
-  }
-  else if(mRelationship == "descendants") {
-    validate(false, false);
-  }
-  else if(mRelationship == "everyone") {
-    return;
-  }
-  else if(mRelationship == "father") {
-    validate(false, false);
-  }
-  else if(mRelationship == "grandchildren") {
-    validate(false, false);
-  }
-  else if(mRelationship == "granddaughters") {
-    validate(false, false);
-  }
-  else if(mRelationship == "grandfathers") {
-    validate(true, false);
-  }
-  else if(mRelationship == "grandmothers") {
-    validate(true, false);
-  }
-  else if(mRelationship == "grandparents") {
-    validate(true, false);
-  }
-  else if(mRelationship == "grandsons") {
-    validate(false, false);
-  }
-  else if(mRelationship == "mother") {
-    validate(false, false);
-  }
-  else if(mRelationship == "nephews") {
-    validate(true, true);
-  }
-  else if(mRelationship == "nieces") {
-    validate(true, true);
-  }
-  else if(mRelationship == "parents") {
-    validate(true, false);
+// Generate a query string:
+std::string Query::to_string() const {
+  return mExpression.to_string();
+}
+
+
+// Relationship questions start with "How is":
+bool KinshipQuery::matches(const std::string& text) {
+  std::istringstream stream(text);
+  std::string how;
+  std::string is;
+  stream >> how >> is;
+  return (how == "How" || how == "how") && is == "is";
+}
+
+// Construct a relationship question from a string:
+KinshipQuery::KinshipQuery(const std::string& text) {
+  Trace::Span span;
+  std::istringstream stream(text);
+  std::vector<std::string> terms;
+  std::string term;
+  while(stream >> term) {
+    terms.push_back(term);
   }
-  else if(mRelationship == "siblings") {
-    validate(true, true);
+
+  // The question mark is optional, and may stand on its own:
+  if(!terms.empty() && terms.back() == "?") {
+    terms.pop_back();
   }
-  else if(mRelationship == "sisters") {
-    validate(true, true);
+  else if(!terms.empty() && terms.back().back() == '?') {
+    terms.back().pop_back();
   }
-  else if(mRelationship == "sons") {
-    validate(false, false);
+
+  if(terms.size() < 6) {
+    throw std::invalid_argument("Too few terms in query.");
   }
-  else if(mRelationship == "uncles") {
-    validate(true, true);
+  if(terms.size() > 6) {
+    throw std::invalid_argument("Too many terms in query.");
   }
-  else {
-    throw std::invalid_argument("Unknown relationship: " + mRelationship);
+  if(terms[3] != "related" || terms[4] != "to") {
+    throw std::invalid_argument("Ask as: How is X related to Y?");
   }
-}
 
-// Generate a query string:
-std::string Query::to_string() const {
-  std::string result = mName + "'s ";
+  mName  = terms[2];
+  mOther = terms[5];
+  std::replace(mName.begin(), mName.end(), '_', ' ');
+  std::replace(mOther.begin(), mOther.end(), '_', ' ');
+  span.done(Trace::Kind::PARSE, 0);
+}
 
-  if(mPMod == PMod::MATERNAL) {
-    result += "maternal ";
+// Answer a relationship question:
+std::string KinshipQuery::run(const GenePool& pool) const {
+  Trace::Span span;
+  Person* person = pool.find(mName);
+  if(person == nullptr) {
+    throw std::invalid_argument("No such person: " + mName);
   }
-  else if(mPMod == PMod::PATERNAL) {
-    result += "paternal ";
+  Person* other = pool.find(mOther);
+  if(other == nullptr) {
+    throw std::invalid_argument("No such person: " + mOther);
   }
 
-  if(mSMod == SMod::FULL) {
-    result += "full ";
+  Kinship kinship = pool.relationship(other, person);
+  span.done(Trace::Kind::KINSHIP, kinship.related());
+  if(!kinship.related()) {
+    return mName + " and " + mOther + " are not related.\n";
   }
-  else if(mSMod == SMod::HALF) {
-    result += "half ";
+  if(kinship.up == 0 && kinship.down == 0) {
+    return mName + " and " + mOther + " are the same person.\n";
   }
-
-  result += mRelationship;
-  return result;
+  return mName + " is " + mOther + "'s " + ::to_string(kinship, person->gender()) + ".\n";
 }
@@ -4,16 +4,11 @@
 #include "Roles.h"
 #include "family.h"
 #include "Person.h"
+#include "Expression.h"
 
 
 class Query {
-  std::string mName;
-  std::string mRelationship;
-  PMod        mPMod;
-  SMod        mSMod;
-
-  void validate() const;
-  void validate(bool allow_pmod, bool allow_smod) const;
+  Expression mExpression;
 
 public:
   Query(const std::string& text);
@@ -24,9 +19,21 @@ public:
     SMod smod = SMod::ANY
   );
 
-  std::set<Person*> run(const GenePool& pool) const;
+  PersonSet run(const GenePool& pool) const;
   std::string to_string() const;
 };
 
-#endif
+// "How is Bob related to Alice?" names what one person is to another.
+class KinshipQuery {
+  std::string mName;
+  std::string mOther;
 
+public:
+  static bool matches(const std::string& text);
+  KinshipQuery(const std::string& text);
+
+  // A sentence like "Bob is Alice's paternal first cousin."
+  std::string run(const GenePool& pool) const;
+};
+
+#endif
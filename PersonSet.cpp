@@ -0,0 +1,432 @@
+#include "PersonSet.h"
+// PersonSet Member Functions
+#include "family.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+Buffers are power-of-two blocks of IDs. Each thread keeps a few freed
+blocks of each size for its next results. A block may be freed on another
+thread than the one that made it; it just joins that thread's cache.
+Very large blocks are not worth holding on to and go straight back.
+*/
+namespace {
+    const unsigned CLASSES   = 32;
+    const unsigned MAX_CLASS = 20;  // Cache blocks of up to 2^20 IDs (4 MB)
+    const size_t   KEEP      = 8;   // Blocks cached per size
+
+    struct BlockCache {
+        std::vector<PersonID*> free[CLASSES];
+
+        ~BlockCache() {
+            for (auto& blocks : free) {
+                for (PersonID* block : blocks) ::operator delete(block);
+            }
+        }
+    };
+
+    thread_local BlockCache cache;
+
+    unsigned sizeClass(size_t capacity) {
+        unsigned result = 0;
+        while ((size_t(1) << result) < capacity) ++result;
+        return result;
+    }
+
+    PersonID* allocate(unsigned cls) {
+        Trace::allocate();
+        if (cls <= MAX_CLASS && !cache.free[cls].empty()) {
+            PersonID* block = cache.free[cls].back();
+            cache.free[cls].pop_back();
+            return block;
+        }
+        return static_cast<PersonID*>(::operator new(sizeof(PersonID) << cls));
+    }
+
+    void deallocate(PersonID* block, unsigned cls) {
+        if (cls <= MAX_CLASS && cache.free[cls].size() < KEEP) {
+            cache.free[cls].push_back(block);
+            return;
+        }
+        ::operator delete(block);
+    }
+
+    const uint64_t ONE = 1;
+
+    // Write the members of a bitset out as IDs; returns how many.
+    size_t decode(const uint64_t* words, size_t count, PersonID* out) {
+        PersonID* start = out;
+        for (size_t i = 0; i < count; ++i) {
+            for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+                *out++ = static_cast<PersonID>(i * 64 + __builtin_ctzll(word));
+            }
+        }
+        return out - start;
+    }
+
+    /*
+    Bitset algebra: a = a | b, a & b or a & ~b over count words, returning
+    the members left in a. With AVX2, four words go at a time, and their
+    bits are counted with the nibble-table method (a byte shuffle looks up
+    each nibble's count; a sum of absolute differences adds up the bytes).
+    With SSE2, two words go at a time and are counted one by one.
+    */
+    enum class Combine { OR, AND, ANDNOT };
+
+#if defined(__AVX2__)
+    inline __m256i popcount(__m256i v) {
+        const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                               0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low  = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+    }
+#endif
+
+    template <Combine OP>
+    size_t combine(uint64_t* a, const uint64_t* b, size_t count) {
+        size_t i = 0;
+        size_t members = 0;
+#if defined(__AVX2__)
+        __m256i total = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i r = OP == Combine::OR  ? _mm256_or_si256(x, y)
+                      : OP == Combine::AND ? _mm256_and_si256(x, y)
+                      :                      _mm256_andnot_si256(y, x);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), r);
+            total = _mm256_add_epi64(total, popcount(r));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+        members = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+        for (; i + 2 <= count; i += 2) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            __m128i r = OP == Combine::OR  ? _mm_or_si128(x, y)
+                      : OP == Combine::AND ? _mm_and_si128(x, y)
+                      :                      _mm_andnot_si128(y, x);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), r);
+            members += __builtin_popcountll(a[i]) + __builtin_popcountll(a[i + 1]);
+        }
+#endif
+        for (; i < count; ++i) {
+            a[i] = OP == Combine::OR ? a[i] | b[i] : OP == Combine::AND ? a[i] & b[i] : a[i] & ~b[i];
+            members += __builtin_popcountll(a[i]);
+        }
+        return members;
+    }
+}
+
+// Constructors
+PersonSet::PersonSet(const PersonSet& other) : m_pool(other.m_pool), m_data(m_inline) {
+    *this = other;
+}
+
+PersonSet::PersonSet(PersonSet&& other) noexcept : m_pool(other.m_pool), m_data(m_inline) {
+    *this = std::move(other);
+}
+
+// Assignment
+PersonSet& PersonSet::operator = (const PersonSet& other) {
+    if (this == &other) return *this;
+
+    if (m_dense) release();
+    m_pool = other.m_pool;
+    m_size = 0;
+    if (other.m_dense) {
+        release();
+        m_data = allocate(sizeClass(other.m_capacity));
+        m_capacity = other.m_capacity;
+        m_dense = true;
+        std::memcpy(m_data, other.m_data, other.words() * sizeof(uint64_t));
+    }
+    else {
+        reserve(other.m_size);
+        std::memcpy(m_data, other.m_data, other.m_size * sizeof(PersonID));
+    }
+    m_size = other.m_size;
+    return *this;
+}
+
+PersonSet& PersonSet::operator = (PersonSet&& other) noexcept {
+    if (this == &other) return *this;
+
+    release();
+    m_pool = other.m_pool;
+    m_size = other.m_size;
+    if (other.m_data == other.m_inline) {
+        std::memcpy(m_inline, other.m_inline, other.m_size * sizeof(PersonID));
+    }
+    else {
+        m_data = other.m_data;
+        m_capacity = other.m_capacity;
+        m_dense = other.m_dense;
+        other.m_data = other.m_inline;
+        other.m_capacity = INLINE;
+        other.m_dense = false;
+    }
+    other.m_size = 0;
+    return *this;
+}
+
+// Helper Functions
+void PersonSet::grow(size_t capacity) {
+    unsigned cls = sizeClass(std::max<size_t>(capacity, size_t(m_capacity) * 2));
+    PersonID* data = allocate(cls);
+    std::memcpy(data, m_data, m_size * sizeof(PersonID));
+    release();
+    m_data = data;
+    m_capacity = uint32_t(1) << cls;
+}
+
+void PersonSet::release() {
+    if (m_data != m_inline) {
+        deallocate(m_data, sizeClass(m_capacity));
+        m_data = m_inline;
+        m_capacity = INLINE;
+    }
+    m_dense = false;
+}
+
+size_t PersonSet::universe() const {
+    return m_pool != nullptr ? m_pool->store().size() : 0;
+}
+
+// Dense sets never fit inline, so tiny pools always stay sparse.
+bool PersonSet::shouldBeDense(size_t size) const {
+    size_t people = universe();
+    return people > 64 * INLINE && size * DENSITY > people;
+}
+
+void PersonSet::densify() {
+    size_t count = words();
+    unsigned cls = sizeClass(2 * count);
+    uint64_t* words = reinterpret_cast<uint64_t*>(allocate(cls));
+    std::memset(words, 0, count * sizeof(uint64_t));
+    for (uint32_t i = 0; i < m_size; ++i) {
+        words[m_data[i] / 64] |= ONE << (m_data[i] % 64);
+    }
+
+    release();
+    m_data = reinterpret_cast<PersonID*>(words);
+    m_capacity = uint32_t(1) << cls;
+    m_dense = true;
+}
+
+void PersonSet::sparsify() {
+    PersonID* old = m_data;
+    uint32_t capacity = m_capacity;
+    unsigned cls = sizeClass(m_size);
+
+    m_data = m_size <= INLINE ? m_inline : allocate(cls);
+    m_capacity = m_size <= INLINE ? INLINE : uint32_t(1) << cls;
+    m_dense = false;
+    decode(reinterpret_cast<const uint64_t*>(old), words(), m_data);
+    deallocate(old, sizeClass(capacity));
+}
+
+// After a bulk change: switch layouts if the set has crossed the line.
+// Sets turn back into arrays at half the density they turned into bitsets,
+// so one on the line does not flip back and forth.
+void PersonSet::settle() {
+    if (m_dense && size_t(m_size) * DENSITY * 2 < universe()) sparsify();
+    else if (!m_dense && shouldBeDense(m_size)) densify();
+}
+
+// Set Functions
+void PersonSet::insert(PersonID id) {
+    if (m_dense) {
+        uint64_t& word = bits()[id / 64];
+        uint64_t bit = ONE << (id % 64);
+        m_size += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+
+    PersonID* position = m_data + m_size;
+    if (m_size != 0 && id <= m_data[m_size - 1]) {
+        position = std::lower_bound(m_data, m_data + m_size, id);
+        if (*position == id) return;
+    }
+
+    size_t index = position - m_data;
+    if (m_size == m_capacity) {
+        if (shouldBeDense(m_size + 1)) {
+            densify();
+            insert(id);
+            return;
+        }
+        grow(m_size + 1);
+    }
+    std::memmove(m_data + index + 1, m_data + index, (m_size - index) * sizeof(PersonID));
+    m_data[index] = id;
+    ++m_size;
+}
+
+void PersonSet::insert(const Person* person) {
+    insert(person->id());
+}
+
+/*
+Append, then sort and drop duplicates. When the set was empty and the
+new IDs are already in order (as from a walk over sorted IDs), the sort
+is skipped. If the result could be dense, the IDs go straight into a
+bitset instead, and are not sorted at all.
+*/
+void PersonSet::insert(const PersonID* first, const PersonID* last) {
+    size_t count = last - first;
+    if (count == 0) return;
+
+    if (!m_dense && shouldBeDense(m_size + count)) densify();
+    if (m_dense) {
+        uint64_t* words = bits();
+        size_t added = 0;
+        for (const PersonID* id = first; id != last; ++id) {
+            uint64_t bit = ONE << (*id % 64);
+            added += (words[*id / 64] & bit) == 0;
+            words[*id / 64] |= bit;
+        }
+        m_size += static_cast<uint32_t>(added);
+        settle();
+        return;
+    }
+
+    bool ordered = m_size == 0 || m_data[m_size - 1] < *first;
+    reserve(m_size + count);
+    std::memcpy(m_data + m_size, first, count * sizeof(PersonID));
+
+    PersonID* begin = m_data + (ordered ? m_size : 0);
+    PersonID* end = m_data + m_size + count;
+    if (!ordered || !std::is_sorted(begin, end)) {
+        std::sort(m_data, end);
+    }
+    m_size = static_cast<uint32_t>(std::unique(m_data, end) - m_data);
+}
+
+void PersonSet::merge(const PersonSet& other) {
+    if (m_pool == nullptr) m_pool = other.m_pool;
+    if (!other.m_dense) {
+        insert(other.m_data, other.m_data + other.m_size);
+        return;
+    }
+
+    if (!m_dense) densify();
+    m_size = static_cast<uint32_t>(combine<Combine::OR>(bits(), other.bits(), words()));
+}
+
+/*
+With both sets dense, this is a pass over the words. Otherwise the result
+is no bigger than the sparse side, so that side is walked: against a
+bitset each ID is a bit test, and against another array it is a merge.
+*/
+void PersonSet::intersect(const PersonSet& other) {
+    if (m_dense && other.m_dense) {
+        m_size = static_cast<uint32_t>(combine<Combine::AND>(bits(), other.bits(), words()));
+        settle();
+        return;
+    }
+
+    if (m_dense) {
+        PersonSet result(m_pool);
+        result.reserve(other.m_size);
+        const uint64_t* words = bits();
+        for (uint32_t i = 0; i < other.m_size; ++i) {
+            PersonID id = other.m_data[i];
+            if (words[id / 64] & (ONE << (id % 64))) result.m_data[result.m_size++] = id;
+        }
+        *this = std::move(result);
+        return;
+    }
+
+    PersonID* out = m_data;
+    if (other.m_dense) {
+        const uint64_t* words = other.bits();
+        for (uint32_t i = 0; i < m_size; ++i) {
+            PersonID id = m_data[i];
+            if (words[id / 64] & (ONE << (id % 64))) *out++ = id;
+        }
+    }
+    else {
+        const PersonID* theirs = other.m_data;
+        const PersonID* end = other.m_data + other.m_size;
+        for (uint32_t i = 0; i < m_size && theirs != end; ++i) {
+            while (theirs != end && *theirs < m_data[i]) ++theirs;
+            if (theirs != end && *theirs == m_data[i]) *out++ = m_data[i];
+        }
+    }
+    m_size = static_cast<uint32_t>(out - m_data);
+}
+
+void PersonSet::subtract(const PersonSet& other) {
+    if (m_dense && other.m_dense) {
+        m_size = static_cast<uint32_t>(combine<Combine::ANDNOT>(bits(), other.bits(), words()));
+        settle();
+        return;
+    }
+
+    if (m_dense) {
+        uint64_t* words = bits();
+        for (uint32_t i = 0; i < other.m_size; ++i) {
+            PersonID id = other.m_data[i];
+            uint64_t bit = ONE << (id % 64);
+            m_size -= (words[id / 64] & bit) != 0;
+            words[id / 64] &= ~bit;
+        }
+        settle();
+        return;
+    }
+
+    PersonID* out = m_data;
+    if (other.m_dense) {
+        const uint64_t* words = other.bits();
+        for (uint32_t i = 0; i < m_size; ++i) {
+            PersonID id = m_data[i];
+            if (!(words[id / 64] & (ONE << (id % 64)))) *out++ = id;
+        }
+    }
+    else {
+        const PersonID* theirs = other.m_data;
+        const PersonID* end = other.m_data + other.m_size;
+        for (uint32_t i = 0; i < m_size; ++i) {
+            while (theirs != end && *theirs < m_data[i]) ++theirs;
+            if (theirs == end || *theirs != m_data[i]) *out++ = m_data[i];
+        }
+    }
+    m_size = static_cast<uint32_t>(out - m_data);
+}
+
+void PersonSet::clear() {
+    if (m_dense) release();
+    m_size = 0;
+}
+
+// Getter Functions
+bool PersonSet::contains(PersonID id) const {
+    if (m_dense) {
+        return id < universe() && (bits()[id / 64] & (ONE << (id % 64))) != 0;
+    }
+    return std::binary_search(m_data, m_data + m_size, id);
+}
+
+size_t PersonSet::count(const Person* person) const {
+    return person != nullptr && contains(person->id()) ? 1 : 0;
+}
+
+void PersonSet::ids(std::vector<PersonID>& out) const {
+    size_t start = out.size();
+    out.resize(start + m_size);
+    if (m_dense) decode(bits(), words(), out.data() + start);
+    else std::memcpy(out.data() + start, m_data, m_size * sizeof(PersonID));
+}
@@ -0,0 +1,144 @@
+#ifndef PERSONSET_H
+#define PERSONSET_H
+
+#include "PersonStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+class GenePool;
+class Person;
+
+// The result of a relationship query: a set of people, kept as a sorted
+// array of their IDs. Up to INLINE people fit inside the object itself;
+// larger sets take their buffer from a per-thread cache of blocks, so
+// building and dropping results does not go to the heap for every query.
+//
+// Once a set holds more than one person in DENSITY of its pool, it turns
+// into a bitset with one bit per person in the pool instead (which is then
+// the smaller of the two), and unions, intersections and differences with
+// other dense sets go a word at a time. Sets that thin out turn back.
+//
+// Iterating yields Person* (from the pool), like the std::set<Person*>
+// this replaces, but in ID order rather than address order.
+class PersonSet {
+public:
+  static const uint32_t INLINE  = 8;
+  static const uint32_t DENSITY = 32;
+
+  class const_iterator {
+    const GenePool* m_pool;
+    const PersonID* m_id;     // Sparse sets: the current member
+    const uint64_t* m_words;  // Dense sets: the bits (null for sparse sets)
+    size_t          m_bit;    // Dense sets: the current member
+    size_t          m_bits;
+
+    void skip();  // Move m_bit on to the next member, or to m_bits
+
+  public:
+    // Dereferencing makes a Person* rather than returning a reference, so
+    // this is only an input iterator as far as the standard is concerned.
+    typedef std::input_iterator_tag iterator_category;
+    typedef Person*        value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Person* const* pointer;
+    typedef Person*        reference;
+
+    const_iterator(const GenePool* pool, const PersonID* id)
+      : m_pool(pool), m_id(id), m_words(nullptr), m_bit(0), m_bits(0) {}
+    const_iterator(const GenePool* pool, const uint64_t* words, size_t bit, size_t bits)
+      : m_pool(pool), m_id(nullptr), m_words(words), m_bit(bit), m_bits(bits) { skip(); }
+
+    Person*  operator * () const;  // Defined in family.h
+    PersonID id() const { return m_words ? static_cast<PersonID>(m_bit) : *m_id; }
+
+    const_iterator& operator ++ () {
+      if (m_words) { ++m_bit; skip(); }
+      else ++m_id;
+      return *this;
+    }
+    const_iterator  operator ++ (int) { const_iterator old = *this; ++*this; return old; }
+
+    bool operator == (const const_iterator& other) const { return m_id == other.m_id && m_bit == other.m_bit; }
+    bool operator != (const const_iterator& other) const { return !(*this == other); }
+  };
+  typedef const_iterator iterator;
+
+private:
+  // Member Variables
+  const GenePool* m_pool;
+  PersonID*       m_data;              // Sorted IDs, or the bitset's words
+  uint32_t        m_size     = 0;
+  uint32_t        m_capacity = INLINE; // In IDs, for either layout
+  bool            m_dense    = false;
+  PersonID        m_inline[INLINE];
+
+  // Helper Functions
+  void grow(size_t capacity);
+  void release();
+  size_t universe() const;
+  size_t words() const { return (universe() + 63) / 64; }
+  uint64_t* bits() const { return reinterpret_cast<uint64_t*>(m_data); }
+  bool shouldBeDense(size_t size) const;
+  void densify();
+  void sparsify();
+  void settle();
+
+public:
+  explicit PersonSet(const GenePool* pool = nullptr) : m_pool(pool), m_data(m_inline) {}
+  PersonSet(const PersonSet& other);
+  PersonSet(PersonSet&& other) noexcept;
+  PersonSet& operator = (const PersonSet& other);
+  PersonSet& operator = (PersonSet&& other) noexcept;
+  ~PersonSet() { release(); }
+
+  // Set Functions
+  // Insert one person. Adding IDs in increasing order is an O(1) append.
+  void insert(PersonID id);
+  void insert(const Person* person);
+
+  // Insert any number of IDs at once (unsorted, duplicates allowed).
+  void insert(const PersonID* first, const PersonID* last);
+
+  // Add everyone in another set, keep only the people also in it, or
+  // drop the people in it.
+  void merge(const PersonSet& other);
+  void intersect(const PersonSet& other);
+  void subtract(const PersonSet& other);
+
+  void reserve(size_t capacity) { if (!m_dense && capacity > m_capacity) grow(capacity); }
+  void clear();
+
+  // Getter Functions
+  const GenePool* pool() const { return m_pool; }
+  size_t size() const { return m_size; }
+  bool   empty() const { return m_size == 0; }
+  bool   dense() const { return m_dense; }
+  bool   contains(PersonID id) const;
+  size_t count(const Person* person) const;
+
+  // Append the members' IDs, in increasing order, to out.
+  void ids(std::vector<PersonID>& out) const;
+
+  const_iterator begin() const {
+    return m_dense ? const_iterator(m_pool, bits(), 0, universe()) : const_iterator(m_pool, m_data);
+  }
+  const_iterator end() const {
+    return m_dense ? const_iterator(m_pool, bits(), universe(), universe()) : const_iterator(m_pool, m_data + m_size);
+  }
+};
+
+inline void PersonSet::const_iterator::skip() {
+  while (m_bit < m_bits) {
+    uint64_t word = m_words[m_bit / 64] >> (m_bit % 64);
+    if (word != 0) {
+      m_bit += __builtin_ctzll(word);
+      return;
+    }
+    m_bit = (m_bit / 64 + 1) * 64;
+  }
+  m_bit = m_bits;
+}
+
+#endif
@@ -0,0 +1,224 @@
+#include "PersonStore.h"
+// PersonStore Member Functions
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+void PersonStore::resize(size_t count, size_t nameBytes) {
+    m_nameOffsets.assign(count + 1, 0);
+    m_nameOffsets.set(count, nameBytes);
+    m_nameChars.assign(nameBytes, '\0');
+    m_genders.assign(count, Gender::FEMALE);
+    m_mothers.assign(count, NO_PERSON);
+    m_fathers.assign(count, NO_PERSON);
+}
+
+void PersonStore::set(PersonID id, uint64_t nameOffset, std::string_view name, Gender gender) {
+    m_nameOffsets.set(id, nameOffset);
+    std::memcpy(m_nameChars.mutable_data() + nameOffset, name.data(), name.size());
+    m_genders.set(id, gender);
+}
+
+/*
+Build the children adjacency with a counting sort over the parent links:
+count each parent's children, prefix-sum the counts into offsets, then
+scatter the child IDs into place. Children end up in ID order, and someone
+listed as both mother and father only counts them once.
+*/
+void PersonStore::buildChildren() {
+    size_t count = size();
+    m_childOffsets.assign(count + 1, 0);
+    uint32_t* offsets = m_childOffsets.mutable_data();
+
+    for (size_t i = 0; i < count; ++i) {
+        if (m_mothers[i] != NO_PERSON) offsets[m_mothers[i] + 1] += 1;
+        if (m_fathers[i] != NO_PERSON && m_fathers[i] != m_mothers[i]) offsets[m_fathers[i] + 1] += 1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    m_moved.clear();
+    m_abandoned = 0;
+    m_childIDs.assign(offsets[count], NO_PERSON);
+    PersonID* children = m_childIDs.mutable_data();
+    std::vector<uint32_t> next(offsets, offsets + count);
+    for (size_t i = 0; i < count; ++i) {
+        if (m_mothers[i] != NO_PERSON) children[next[m_mothers[i]]++] = static_cast<PersonID>(i);
+        if (m_fathers[i] != NO_PERSON && m_fathers[i] != m_mothers[i]) children[next[m_fathers[i]]++] = static_cast<PersonID>(i);
+    }
+}
+
+PersonStore PersonStore::reordered(const std::vector<PersonID>& order) const {
+    size_t count = size();
+    std::vector<PersonID> renamed(count);
+    for (size_t i = 0; i < count; ++i) {
+        renamed[order[i]] = static_cast<PersonID>(i);
+    }
+    auto rename = [&](PersonID id) { return id == NO_PERSON ? NO_PERSON : renamed[id]; };
+
+    PersonStore result;
+    result.resize(count, m_nameOffsets[count]);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        PersonID id = order[i];
+        result.set(static_cast<PersonID>(i), offset, name(id), m_genders[id]);
+        result.setParents(static_cast<PersonID>(i), rename(m_mothers[id]), rename(m_fathers[id]));
+        offset += name(id).size();
+    }
+    result.buildChildren();
+    return result;
+}
+
+// A new person has no parents and, at the end of the offsets, no children
+PersonID PersonStore::add(std::string_view name, Gender gender) {
+    size_t id = size();
+    if (id >= NO_PERSON - 1) {
+        throw std::runtime_error("Too many people in database.");
+    }
+
+    uint64_t offset = m_nameOffsets[id];
+    m_nameChars.resize(offset + name.size());
+    std::memcpy(m_nameChars.mutable_data() + offset, name.data(), name.size());
+    m_nameOffsets.push_back(offset + name.size());
+    m_genders.push_back(gender);
+    m_mothers.push_back(NO_PERSON);
+    m_fathers.push_back(NO_PERSON);
+    m_childOffsets.push_back(m_childOffsets[id]);
+    if (!m_moved.empty()) m_moved.push_back(Moved{UNMOVED, 0});
+    return static_cast<PersonID>(id);
+}
+
+void PersonStore::link(PersonID id, PersonID mother, PersonID father) {
+    PersonID oldMother = m_mothers[id];
+    PersonID oldFather = m_fathers[id];
+    setParents(id, mother, father);
+
+    auto has = [](PersonID person, PersonID a, PersonID b) {
+        return person != NO_PERSON && (person == a || person == b);
+    };
+    if (oldMother != NO_PERSON && !has(oldMother, mother, father)) rewrite(oldMother, id, NO_PERSON);
+    if (oldFather != NO_PERSON && oldFather != oldMother && !has(oldFather, mother, father)) rewrite(oldFather, id, NO_PERSON);
+    if (mother != NO_PERSON && !has(mother, oldMother, oldFather)) rewrite(mother, NO_PERSON, id);
+    if (father != NO_PERSON && father != mother && !has(father, oldMother, oldFather)) rewrite(father, NO_PERSON, id);
+
+    if (m_abandoned > 1024 && m_abandoned * 2 > m_childIDs.size()) {
+        buildChildren();
+    }
+}
+
+/*
+Write a parent's children list again at the end of the children column,
+without drop and with add (kept in ID order), and point the parent at it.
+*/
+void PersonStore::rewrite(PersonID parent, PersonID drop, PersonID add) {
+    if (m_moved.empty()) m_moved.assign(size(), Moved{UNMOVED, 0});
+
+    IDRange old = children(parent);
+    size_t first = m_childIDs.size();
+    size_t last = first + old.size() - (drop != NO_PERSON) + (add != NO_PERSON);
+    if (last >= UNMOVED) {
+        throw std::runtime_error("Too many children lists in database.");
+    }
+
+    // Copy the old list out first: growing the column may move it.
+    std::vector<PersonID> ids(old.begin(), old.end());
+    m_childIDs.resize(last);
+    PersonID* out = m_childIDs.mutable_data() + first;
+    for (PersonID child : ids) {
+        if (add != NO_PERSON && add < child) {
+            *out++ = add;
+            add = NO_PERSON;
+        }
+        if (child != drop) *out++ = child;
+    }
+    if (add != NO_PERSON) *out++ = add;
+
+    m_abandoned += ids.size();
+    m_moved[parent] = Moved{static_cast<uint32_t>(first), static_cast<uint32_t>(last)};
+}
+
+/*
+Kahn's algorithm over the parent links: repeatedly retire people whose
+parents have all been retired. Anyone left over sits on or below a cycle.
+*/
+PersonID PersonStore::findCycle() const {
+    size_t count = size();
+    std::vector<uint8_t>  pending(count);
+    std::vector<PersonID> ready;
+
+    for (size_t i = 0; i < count; ++i) {
+        pending[i] = (m_mothers[i] != NO_PERSON) + (m_fathers[i] != NO_PERSON && m_fathers[i] != m_mothers[i]);
+        if (pending[i] == 0) ready.push_back(static_cast<PersonID>(i));
+    }
+
+    size_t retired = 0;
+    while (!ready.empty()) {
+        PersonID id = ready.back();
+        ready.pop_back();
+        ++retired;
+        for (PersonID child : children(id)) {
+            if (--pending[child] == 0) ready.push_back(child);
+        }
+    }
+
+    if (retired == count) return NO_PERSON;
+    for (size_t i = 0; i < count; ++i) {
+        if (pending[i] != 0) return static_cast<PersonID>(i);
+    }
+    return NO_PERSON;
+}
+
+std::pair<const void*, size_t> PersonStore::section(Section section) const {
+    switch (section) {
+        case NAME_OFFSETS:  return {m_nameOffsets.data(), m_nameOffsets.size() * sizeof(uint64_t)};
+        case NAME_CHARS:    return {m_nameChars.data(), m_nameChars.size()};
+        case GENDERS:       return {m_genders.data(), m_genders.size() * sizeof(Gender)};
+        case MOTHERS:       return {m_mothers.data(), m_mothers.size() * sizeof(PersonID)};
+        case FATHERS:       return {m_fathers.data(), m_fathers.size() * sizeof(PersonID)};
+        case CHILD_OFFSETS: return {m_childOffsets.data(), m_childOffsets.size() * sizeof(uint32_t)};
+        case CHILD_IDS:     return {m_childIDs.data(), m_childIDs.size() * sizeof(PersonID)};
+        default:            return {nullptr, 0};
+    }
+}
+
+size_t PersonStore::bytes(Section section) const {
+    switch (section) {
+        case NAME_OFFSETS:  return m_nameOffsets.bytes();
+        case NAME_CHARS:    return m_nameChars.bytes();
+        case GENDERS:       return m_genders.bytes();
+        case MOTHERS:       return m_mothers.bytes();
+        case FATHERS:       return m_fathers.bytes();
+        case CHILD_OFFSETS: return m_childOffsets.bytes();
+        case CHILD_IDS:     return m_childIDs.bytes();
+        default:            return 0;
+    }
+}
+
+void PersonStore::shrink() {
+    if (!packed()) buildChildren();
+    m_moved.shrink_to_fit();
+    m_nameOffsets.shrink();
+    m_nameChars.shrink();
+    m_genders.shrink();
+    m_mothers.shrink();
+    m_fathers.shrink();
+    m_childOffsets.shrink();
+    m_childIDs.shrink();
+}
+
+void PersonStore::view(const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing) {
+    auto typed = [&](Section section, auto* column) {
+        typedef typename std::remove_reference<decltype(*column->data())>::type Element;
+        column->view(static_cast<const Element*>(sections[section].first), sections[section].second / sizeof(Element));
+    };
+
+    typed(NAME_OFFSETS, &m_nameOffsets);
+    typed(NAME_CHARS, &m_nameChars);
+    typed(GENDERS, &m_genders);
+    typed(MOTHERS, &m_mothers);
+    typed(FATHERS, &m_fathers);
+    typed(CHILD_OFFSETS, &m_childOffsets);
+    typed(CHILD_IDS, &m_childIDs);
+    m_backing = std::move(backing);
+}
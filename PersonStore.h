@@ -0,0 +1,150 @@
+#ifndef PERSONSTORE_H
+#define PERSONSTORE_H
+
+#include "Column.h"
+#include "Roles.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// People are identified by dense IDs into the arrays below.
+typedef uint32_t PersonID;
+const PersonID NO_PERSON = UINT32_MAX;
+
+// A read-only run of person IDs (e.g. one person's children).
+struct IDRange {
+  const PersonID* first;
+  const PersonID* last;
+
+  const PersonID* begin() const { return first; }
+  const PersonID* end()   const { return last; }
+  size_t size()  const { return last - first; }
+  bool   empty() const { return first == last; }
+  PersonID operator [] (size_t i) const { return first[i]; }
+};
+
+// Struct-of-arrays storage for a whole family tree.
+// Names live back to back in one character table, indexed by offset.
+// Parent links are filled in as people are loaded; the children adjacency is
+// built once, in compressed sparse row form, by buildChildren(). Every array
+// is a Column, so a store can also run directly on a mapped snapshot.
+//
+// A built store can still be edited with add() and link(). A children list
+// that changes is written again at the end of the children column and the
+// old copy left behind, so an edit costs about one family's worth of work;
+// buildChildren() packs the lists back together (and edits do so themselves
+// once half the column is left behind).
+class PersonStore {
+  struct Moved {
+    uint32_t first;  // UNMOVED, or where the list now starts
+    uint32_t last;
+  };
+  static constexpr uint32_t UNMOVED = UINT32_MAX;
+
+  // Member Variables
+  Column<uint64_t> m_nameOffsets;  // Name i is m_nameChars[m_nameOffsets[i] .. m_nameOffsets[i + 1])
+  Column<char>     m_nameChars;
+  Column<Gender>   m_genders;
+  Column<PersonID> m_mothers;
+  Column<PersonID> m_fathers;
+
+  // The children of person i are m_childIDs[m_childOffsets[i] .. m_childOffsets[i + 1]).
+  Column<uint32_t> m_childOffsets;
+  Column<PersonID> m_childIDs;
+
+  // Lists moved by edits (empty while the store is packed), and how many
+  // IDs in m_childIDs they left behind.
+  std::vector<Moved> m_moved;
+  size_t m_abandoned = 0;
+
+  // Keeps a mapped snapshot alive while columns view it.
+  std::shared_ptr<const void> m_backing;
+
+  // Helper Functions
+  void rewrite(PersonID parent, PersonID drop, PersonID add);
+
+public:
+  // The columns, in a fixed order, for snapshots.
+  enum Section : uint32_t {
+    NAME_OFFSETS, NAME_CHARS, GENDERS, MOTHERS, FATHERS, CHILD_OFFSETS, CHILD_IDS, SECTIONS
+  };
+
+  // Bulk loading: size the store for count people whose names total
+  // nameBytes, then fill everyone in with set() (name offsets must run in ID
+  // order, each name starting where the previous one ends). Different
+  // threads may set different people.
+  void resize(size_t count, size_t nameBytes);
+  void set(PersonID id, uint64_t nameOffset, std::string_view name, Gender gender);
+
+  // Link a person to their parents after the fact (e.g. once the parents
+  // have been loaded). Call buildChildren() afterwards.
+  void setParents(PersonID id, PersonID mother, PersonID father) {
+    m_mothers.set(id, mother);
+    m_fathers.set(id, father);
+  }
+
+  // Build the children adjacency from the parent links.
+  void buildChildren();
+
+  // A packed copy of the store with person order[i] as person i: names,
+  // genders and parent links move with them. order must list everyone once.
+  PersonStore reordered(const std::vector<PersonID>& order) const;
+
+  // Edits, for a store that has been built: add a person with no parents
+  // (returning their ID), or replace someone's parents, updating the
+  // children lists of the old and new parents. Neither checks for cycles.
+  PersonID add(std::string_view name, Gender gender);
+  void link(PersonID id, PersonID mother, PersonID father);
+
+  // Have edits moved any children lists? Snapshots need a packed store.
+  bool packed() const { return m_moved.empty(); }
+
+  // Return someone who is their own ancestor (or descends from someone who
+  // is), or NO_PERSON if the parent links are acyclic. Needs buildChildren().
+  PersonID findCycle() const;
+
+  // Raw access to one column's bytes, for snapshots.
+  std::pair<const void*, size_t> section(Section section) const;
+
+  // Heap bytes held by one column (none while it views a snapshot), and by
+  // the bookkeeping for moved children lists.
+  size_t bytes(Section section) const;
+  size_t movedBytes() const { return m_moved.capacity() * sizeof(Moved); }
+
+  // Pack the children lists if edits have moved any, and give back the
+  // spare capacity edits leave in the columns.
+  void shrink();
+
+  // Run on columns stored elsewhere. sections[i] is the data for Section i;
+  // backing is held until the store is destroyed or views something else.
+  void view(const std::pair<const void*, size_t>* sections, std::shared_ptr<const void> backing);
+
+  // Getter Functions
+  size_t size() const { return m_genders.size(); }
+  std::string_view name(PersonID id) const {
+    uint64_t first = m_nameOffsets[id];
+    return std::string_view(m_nameChars.data() + first, m_nameOffsets[id + 1] - first);
+  }
+  Gender   gender(PersonID id) const { return m_genders[id]; }
+  PersonID mother(PersonID id) const { return m_mothers[id]; }
+  PersonID father(PersonID id) const { return m_fathers[id]; }
+  IDRange  children(PersonID id) const {
+    const PersonID* base = m_childIDs.data();
+    if (!m_moved.empty() && m_moved[id].first != UNMOVED) {
+      return IDRange{base + m_moved[id].first, base + m_moved[id].last};
+    }
+    return IDRange{base + m_childOffsets[id], base + m_childOffsets[id + 1]};
+  }
+
+  // The whole children column, which every children() range lies within
+  // (moved lists and the copies they left behind included).
+  IDRange  childLists() const {
+    const PersonID* base = m_childIDs.data();
+    return IDRange{base, base + m_childIDs.size()};
+  }
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "Plan.h"
+// Plan Member Functions
+#include "family.h"
+#include "Tracing.h"
+#include "Traversal.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// The query words, in Relationship order, and the modifiers each accepts.
+namespace {
+    struct RelationshipInfo {
+        const char* word;
+        bool        pmod;
+        bool        smod;
+    };
+
+    const RelationshipInfo RELATIONSHIPS[] = {
+        {"ancestors", true, false},      {"aunts", true, true},
+        {"brothers", true, true},        {"children", false, false},
+        {"cousins", true, true},         {"daughters", false, false},
+        {"descendants", false, false},   {"everyone", false, false},
+        {"father", false, false},        {"grandchildren", false, false},
+        {"granddaughters", false, false}, {"grandfathers", true, false},
+        {"grandmothers", true, false},   {"grandparents", true, false},
+        {"grandsons", false, false},     {"mother", false, false},
+        {"nephews", true, true},         {"nieces", true, true},
+        {"parents", true, false},        {"siblings", true, true},
+        {"sisters", true, true},         {"sons", false, false},
+        {"uncles", true, true},
+    };
+
+    const RelationshipInfo& info(Relationship relationship) {
+        return RELATIONSHIPS[static_cast<size_t>(relationship)];
+    }
+}
+
+// The table is in alphabetical order, so a binary search finds the word.
+bool parseRelationship(std::string_view word, Relationship& relationship) {
+    auto begin = std::begin(RELATIONSHIPS);
+    auto end = std::end(RELATIONSHIPS);
+    auto it = std::lower_bound(begin, end, word, [](const RelationshipInfo& entry, std::string_view key) {
+        return std::string_view(entry.word) < key;
+    });
+
+    if (it == end || word != it->word) return false;
+    relationship = static_cast<Relationship>(it - begin);
+    return true;
+}
+
+const char* to_string(Relationship relationship) {
+    return info(relationship).word;
+}
+
+bool allowsPMod(Relationship relationship) {
+    return info(relationship).pmod;
+}
+
+bool allowsSMod(Relationship relationship) {
+    return info(relationship).smod;
+}
+
+// Helper Functions
+static bool allows(PMod pmod, PMod side) {
+    return pmod == PMod::ANY || pmod == side;
+}
+
+static bool matches(Gender gender, Gender filter) {
+    return filter == Gender::ANY || gender == filter;
+}
+
+// Is child listed as a child of parent (as either mother or father)?
+static bool childOf(const PersonStore& store, PersonID child, PersonID parent) {
+    return parent != NO_PERSON && (store.mother(child) == parent || store.father(child) == parent);
+}
+
+/*
+Do a and b share a parent in the same role, as required by pmod and smod?
+Brothers, sisters, nephews and nieces check this on top of being siblings.
+*/
+static bool sharesParents(const PersonStore& store, PersonID a, PersonID b, PMod pmod, SMod smod) {
+    bool sameMother = store.mother(a) != NO_PERSON && store.mother(a) == store.mother(b);
+    bool sameFather = store.father(a) != NO_PERSON && store.father(a) == store.father(b);
+
+    if (smod == SMod::FULL) {
+        return sameMother && sameFather;
+    }
+    if (smod == SMod::HALF) {
+        return (allows(pmod, PMod::MATERNAL) && sameMother && !sameFather) ||
+               (allows(pmod, PMod::PATERNAL) && sameFather && !sameMother);
+    }
+    return (allows(pmod, PMod::MATERNAL) && sameMother) || (allows(pmod, PMod::PATERNAL) && sameFather);
+}
+
+/*
+Is sibling (a child of parents[side]) one of id's siblings under the step's
+rules? Under MEMBERSHIP, a full sibling is also a child of the other parent.
+*/
+static bool isSibling(const PersonStore& store, const Plan::Step& step, PersonID id, PersonID sibling, const PersonID* parents, int side) {
+    if (sibling == id || !matches(store.gender(sibling), step.gender)) return false;
+    if (step.rule == Plan::Rule::STRICT) {
+        return sharesParents(store, id, sibling, step.pmod, step.smod);
+    }
+
+    bool isFullSibling = childOf(store, sibling, parents[1 - side]);
+    bool member = step.smod == SMod::ANY || (step.smod == SMod::FULL && isFullSibling) || (step.smod == SMod::HALF && !isFullSibling);
+    if (step.rule == Plan::Rule::BOTH) {
+        return member && sharesParents(store, id, sibling, step.pmod, step.smod);
+    }
+    return member;
+}
+
+Plan& Plan::then(Op op, PMod pmod, SMod smod, Gender gender, Rule rule) {
+    m_steps[m_size++] = Step{op, pmod, smod, gender, rule};
+    return *this;
+}
+
+/*
+Send everyone that step produces from id on to the next step, or into out
+after the last one. People can come out more than once (a full sibling is
+reached through both parents, say); run() removes the repeats at the end.
+*/
+void Plan::expand(const GenePool& pool, size_t step, PersonID id, std::vector<PersonID>& out) const {
+    const PersonStore& store = pool.store();
+    const Step& current = m_steps[step];
+    bool last = step + 1 == m_size;
+    Trace::visit(1);
+
+    auto emit = [&](PersonID next) {
+        if (last) {
+            out.push_back(next);
+        }
+        else {
+            expand(pool, step + 1, next, out);
+        }
+    };
+
+    switch (current.op) {
+        case Op::PARENTS: {
+            if (allows(current.pmod, PMod::MATERNAL) && store.mother(id) != NO_PERSON) {
+                emit(store.mother(id));
+            }
+            if (allows(current.pmod, PMod::PATERNAL) && store.father(id) != NO_PERSON) {
+                emit(store.father(id));
+            }
+            break;
+        }
+
+        case Op::CHILDREN: {
+            for (PersonID child : store.children(id)) {
+                if (matches(store.gender(child), current.gender)) {
+                    emit(child);
+                }
+            }
+            break;
+        }
+
+        // Through the mother, then the father. A sibling through both
+        // parents gets the same verdict both times, so the second pass
+        // skips anyone the first pass already considered.
+        case Op::SIBLINGS: {
+            const PersonID parents[2] = {store.mother(id), store.father(id)};
+            const PMod sides[2] = {PMod::MATERNAL, PMod::PATERNAL};
+            bool seenMother = parents[0] != NO_PERSON && allows(current.pmod, PMod::MATERNAL);
+
+            for (int side = 0; side < 2; ++side) {
+                if (parents[side] == NO_PERSON || !allows(current.pmod, sides[side])) continue;
+                for (PersonID sibling : store.children(parents[side])) {
+                    if (side == 1 && seenMother && childOf(store, sibling, parents[0])) continue;
+                    if (isSibling(store, current, id, sibling, parents, side)) {
+                        emit(sibling);
+                    }
+                }
+            }
+            break;
+        }
+
+        // From the closure index if it covers this person, otherwise with a
+        // walk. The walk's buffer is reused, so copy it before going on.
+        case Op::ANCESTORS:
+        case Op::DESCENDANTS: {
+            std::vector<PersonID> reached;
+            std::vector<PersonID>& target = last ? out : reached;
+            const ClosureIndex* index = pool.closure();
+            bool indexed = current.op == Op::ANCESTORS ?
+                index && index->ancestors(id, current.pmod, target) :
+                index && index->descendants(id, target);
+
+            if (!indexed) {
+                const std::vector<PersonID>& walked = current.op == Op::ANCESTORS ?
+                    Traversal::local().ancestors(store, id, current.pmod) :
+                    Traversal::local().descendants(store, id);
+                target.insert(target.end(), walked.begin(), walked.end());
+            }
+            if (!last) {
+                for (PersonID next : reached) expand(pool, step + 1, next, out);
+            }
+            break;
+        }
+    }
+}
+
+// Compile
+Plan Plan::compile(Relationship relationship, PMod pmod, SMod smod) {
+    Plan plan;
+    switch (relationship) {
+        case Relationship::ANCESTORS:      return plan.then(Op::ANCESTORS, pmod);
+        case Relationship::AUNTS:          return plan.then(Op::PARENTS, pmod).then(Op::SIBLINGS, PMod::ANY, smod, Gender::FEMALE);
+        case Relationship::BROTHERS:       return plan.then(Op::SIBLINGS, pmod, smod, Gender::MALE, Rule::STRICT);
+        case Relationship::CHILDREN:       return plan.then(Op::CHILDREN);
+        case Relationship::COUSINS:        return plan.then(Op::PARENTS, pmod).then(Op::SIBLINGS, PMod::ANY, smod).then(Op::CHILDREN);
+        case Relationship::DAUGHTERS:      return plan.then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::FEMALE);
+        case Relationship::DESCENDANTS:    return plan.then(Op::DESCENDANTS);
+        case Relationship::FATHER:         return plan.then(Op::PARENTS, PMod::PATERNAL);
+        case Relationship::GRANDCHILDREN:  return plan.then(Op::CHILDREN).then(Op::CHILDREN);
+        case Relationship::GRANDDAUGHTERS: return plan.then(Op::CHILDREN).then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::FEMALE);
+        case Relationship::GRANDFATHERS:   return plan.then(Op::PARENTS, pmod).then(Op::PARENTS, PMod::PATERNAL);
+        case Relationship::GRANDMOTHERS:   return plan.then(Op::PARENTS, pmod).then(Op::PARENTS, PMod::MATERNAL);
+        case Relationship::GRANDPARENTS:   return plan.then(Op::PARENTS, pmod).then(Op::PARENTS);
+        case Relationship::GRANDSONS:      return plan.then(Op::CHILDREN).then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::MALE);
+        case Relationship::MOTHER:         return plan.then(Op::PARENTS, PMod::MATERNAL);
+        case Relationship::NEPHEWS:        return plan.then(Op::SIBLINGS, pmod, smod, Gender::ANY, Rule::BOTH).then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::MALE);
+        case Relationship::NIECES:         return plan.then(Op::SIBLINGS, pmod, smod, Gender::ANY, Rule::BOTH).then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::FEMALE);
+        case Relationship::PARENTS:        return plan.then(Op::PARENTS, pmod);
+        case Relationship::SIBLINGS:       return plan.then(Op::SIBLINGS, pmod, smod);
+        case Relationship::SISTERS:        return plan.then(Op::SIBLINGS, pmod, smod, Gender::FEMALE, Rule::STRICT);
+        case Relationship::SONS:           return plan.then(Op::CHILDREN, PMod::ANY, SMod::ANY, Gender::MALE);
+        case Relationship::UNCLES:         return plan.then(Op::PARENTS, pmod).then(Op::SIBLINGS, PMod::ANY, smod, Gender::MALE);
+        default: break;
+    }
+    throw std::invalid_argument(std::string("Cannot compile a plan for ") + to_string(relationship) + ".");
+}
+
+// Run
+void Plan::expand(const GenePool& pool, PersonID start, std::vector<PersonID>& out) const {
+    expand(pool, 0, start, out);
+}
+
+void Plan::reach(uint32_t& up, uint32_t& down) const {
+    up = 0;
+    down = 0;
+    for (size_t i = 0; i < m_size; ++i) {
+        Op op = m_steps[i].op;
+        if (op == Op::ANCESTORS) up = UINT32_MAX;
+        if (op == Op::DESCENDANTS) down = UINT32_MAX;
+        if ((op == Op::PARENTS || op == Op::SIBLINGS) && up != UINT32_MAX) ++up;
+        if ((op == Op::CHILDREN || op == Op::SIBLINGS) && down != UINT32_MAX) ++down;
+    }
+}
+
+PersonSet Plan::run(const GenePool& pool, PersonID start) const {
+    thread_local std::vector<PersonID> out;
+    out.clear();
+    expand(pool, 0, start, out);
+
+    PersonSet result(&pool);
+    result.insert(out.data(), out.data() + out.size());
+    return result;
+}
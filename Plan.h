@@ -0,0 +1,94 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "PersonSet.h"
+#include "PersonStore.h"
+#include "Roles.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class GenePool;
+
+// The relationships a query can ask for.
+enum class Relationship : unsigned char {
+  ANCESTORS, AUNTS, BROTHERS, CHILDREN, COUSINS, DAUGHTERS, DESCENDANTS,
+  EVERYONE, FATHER, GRANDCHILDREN, GRANDDAUGHTERS, GRANDFATHERS,
+  GRANDMOTHERS, GRANDPARENTS, GRANDSONS, MOTHER, NEPHEWS, NIECES, PARENTS,
+  SIBLINGS, SISTERS, SONS, UNCLES
+};
+
+// Look up a relationship by its query word. Returns false if unknown.
+bool parseRelationship(std::string_view word, Relationship& relationship);
+
+// The query word for a relationship.
+const char* to_string(Relationship relationship);
+
+// Which modifiers a relationship accepts.
+bool allowsPMod(Relationship relationship);
+bool allowsSMod(Relationship relationship);
+
+// A relationship compiled into a short pipeline of primitive steps. Each
+// step maps one person to a group of people (their parents, children or
+// siblings, say), filtered by gender as it goes. Running a plan pushes
+// every person a step produces straight into the next step, so nothing is
+// collected until the end, where the result is sorted once.
+class Plan {
+public:
+  enum class Op : unsigned char {
+    PARENTS,      // Mother and/or father, by pmod (roles, not genders)
+    CHILDREN,     // Children of the given gender
+    SIBLINGS,     // Siblings of the given gender, by pmod, smod and rule
+    ANCESTORS,    // Everyone above, by pmod on the first step
+    DESCENDANTS,  // Everyone below
+  };
+
+  // How SIBLINGS decides full and half siblings.
+  enum class Rule : unsigned char {
+    MEMBERSHIP,  // Through each parent; full if also the other parent's child
+    STRICT,      // Same parent in the same role (brothers and sisters)
+    BOTH,        // Both of the above (nephews and nieces)
+  };
+
+  struct Step {
+    Op     op;
+    PMod   pmod;
+    SMod   smod;
+    Gender gender;
+    Rule   rule;
+  };
+
+  static const size_t MAX_STEPS = 3;
+
+private:
+  // Member Variables
+  Step    m_steps[MAX_STEPS];
+  uint8_t m_size = 0;
+
+  // Helper Functions
+  Plan& then(Op op, PMod pmod = PMod::ANY, SMod smod = SMod::ANY, Gender gender = Gender::ANY, Rule rule = Rule::MEMBERSHIP);
+  void expand(const GenePool& pool, size_t step, PersonID id, std::vector<PersonID>& out) const;
+
+public:
+  // Compile a relationship (anything but EVERYONE) with its modifiers.
+  static Plan compile(Relationship relationship, PMod pmod = PMod::ANY, SMod smod = SMod::ANY);
+
+  // Run the plan from one person.
+  PersonSet run(const GenePool& pool, PersonID start) const;
+
+  // Append everyone the plan reaches from start to out, unsorted and
+  // possibly repeated. Lets callers run a plan from many people at once.
+  void expand(const GenePool& pool, PersonID start, std::vector<PersonID>& out) const;
+
+  // How many generations the plan climbs, and then descends, at most:
+  // UINT32_MAX for a whole closure. Every plan climbs before it descends, so
+  // a person's answer only depends on the links within that reach.
+  void reach(uint32_t& up, uint32_t& down) const;
+
+  // Getter Functions
+  size_t size() const { return m_size; }
+  const Step& operator [] (size_t i) const { return m_steps[i]; }
+};
+
+#endif
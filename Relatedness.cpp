@@ -0,0 +1,244 @@
+#include "Relatedness.h"
+// Relatedness Member Functions
+#include "Traversal.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace {
+    // Generations too small to be worth spreading over threads:
+    const size_t GRAIN = 256;
+
+    // One thread's working space for inbreeding: a sparse row of the
+    // pedigree's lower-triangular factor, its entries listed by generation.
+    struct Scratch {
+        std::vector<double> weights;
+        std::vector<std::vector<uint32_t>> levels;
+    };
+}
+
+// Constructors
+Relatedness::Relatedness(const PersonStore& store, const std::vector<uint32_t>& generations) {
+    std::vector<PersonID> people(store.size());
+    for (size_t i = 0; i < people.size(); ++i) people[i] = static_cast<PersonID>(i);
+    build(store, generations, std::move(people));
+}
+
+// Gather the people and everyone above them, with the thread's Traversal
+// rather than marks over the whole pool
+Relatedness::Relatedness(const PersonStore& store, const std::vector<uint32_t>& generations, const PersonID* first, const PersonID* last) {
+    std::vector<PersonID> people;
+    for (const PersonID* id = first; id != last; ++id) {
+        if (*id >= store.size()) throw std::out_of_range("No such person.");
+        const std::vector<PersonID>& ancestors = Traversal::local().ancestors(store, *id);
+        people.push_back(*id);
+        people.insert(people.end(), ancestors.begin(), ancestors.end());
+    }
+    std::sort(people.begin(), people.end());
+    people.erase(std::unique(people.begin(), people.end()), people.end());
+    build(store, generations, std::move(people));
+}
+
+/*
+Number everyone by generation, and within a generation by parents, so that
+parents come first and full siblings sit side by side. Then work out
+inbreeding a generation at a time (Meuwissen and Luo, 1992).
+
+A = L D L' where L[i][j] is the share of i's genes that come from j, and D
+holds each person's Mendelian sampling variance: 1/2 - (Fm + Ff)/4, counting
+unknown parents as F = -1. So Fi = sum over i's ancestors j of L[i][j]^2
+D[j], minus one. The row of L is built from i up through the generations:
+each ancestor passes half its weight to each parent. Parents are in earlier
+generations than their children, so visiting ancestors a generation at a
+time, latest first, finishes every weight before it is passed on. (Meuwissen
+and Luo keep the ancestors in one list sorted by number; on deep, wide
+pedigrees the insertions into it cost far more than the rest.)
+
+People with an unknown parent are not inbred, and full siblings are
+equally inbred, so only the first of a sibship needs its row of L.
+*/
+void Relatedness::build(const PersonStore& store, const std::vector<uint32_t>& generations, std::vector<PersonID> people) {
+    std::sort(people.begin(), people.end(), [&](PersonID a, PersonID b) {
+        return std::make_tuple(generations[a], store.mother(a), store.father(a), a)
+             < std::make_tuple(generations[b], store.mother(b), store.father(b), b);
+    });
+
+    size_t count = people.size();
+    m_people = std::move(people);
+    m_positions.resize(count);
+    for (size_t i = 0; i < count; ++i) m_positions[i] = std::make_pair(m_people[i], static_cast<uint32_t>(i));
+    std::sort(m_positions.begin(), m_positions.end());
+
+    // Everyone's parents are covered too
+    m_mothers.resize(count);
+    m_fathers.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        PersonID mother = store.mother(m_people[i]);
+        PersonID father = store.father(m_people[i]);
+        m_mothers[i] = mother == NO_PERSON ? NONE : position(mother);
+        m_fathers[i] = father == NO_PERSON ? NONE : position(father);
+    }
+
+    std::vector<uint32_t> level(count);
+    uint32_t levels = 0;
+    for (size_t i = 0; i < count; ++i) {
+        level[i] = generations[m_people[i]];
+        levels = std::max(levels, level[i] + 1);
+    }
+
+    m_inbreeding.assign(count, 0.0);
+    m_variance.assign(count, 0.0);
+
+    // Each chunk of a generation borrows a Scratch; they stay clean between uses
+    std::vector<std::unique_ptr<Scratch>> spare;
+    std::mutex lock;
+    auto borrow = [&]() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (spare.empty()) {
+            std::unique_ptr<Scratch> scratch(new Scratch);
+            scratch->weights.assign(count, 0.0);
+            scratch->levels.resize(levels);
+            return scratch;
+        }
+        std::unique_ptr<Scratch> scratch = std::move(spare.back());
+        spare.pop_back();
+        return scratch;
+    };
+
+    auto inbreed = [&](uint32_t i, Scratch& scratch) {
+        double* weights = scratch.weights.data();
+        double total = 0.0;
+
+        weights[i] = 1.0;
+        scratch.levels[level[i]].push_back(i);
+        uint32_t lowest = level[i];
+        for (uint32_t g = level[i] + 1; g-- > lowest;) {
+            std::vector<uint32_t>& ancestors = scratch.levels[g];
+            for (uint32_t j : ancestors) {
+                double half = weights[j] / 2;
+                for (uint32_t parent : {m_mothers[j], m_fathers[j]}) {
+                    if (parent == NONE) continue;
+                    if (weights[parent] == 0.0) {
+                        scratch.levels[level[parent]].push_back(parent);
+                        lowest = std::min(lowest, level[parent]);
+                    }
+                    weights[parent] += half;
+                }
+                total += weights[j] * weights[j] * m_variance[j];
+                weights[j] = 0.0;
+            }
+            ancestors.clear();
+        }
+        return total - 1.0;
+    };
+
+    for (size_t start = 0; start < count;) {
+        size_t end = start;
+        while (end < count && level[end] == level[start]) ++end;
+
+        parallelForDynamic(end - start, GRAIN, [&](size_t lo, size_t hi) {
+            std::unique_ptr<Scratch> scratch;
+            for (size_t n = start + lo; n < start + hi; ++n) {
+                uint32_t i = static_cast<uint32_t>(n);
+                uint32_t mother = m_mothers[i];
+                uint32_t father = m_fathers[i];
+                double fm = mother == NONE ? -1.0 : m_inbreeding[mother];
+                double ff = father == NONE ? -1.0 : m_inbreeding[father];
+                m_variance[i] = 0.5 - 0.25 * (fm + ff);
+
+                if (mother == NONE || father == NONE) continue;
+                if (n > start + lo && m_mothers[i - 1] == mother && m_fathers[i - 1] == father) {
+                    m_inbreeding[i] = m_inbreeding[i - 1];
+                    continue;
+                }
+                if (!scratch) scratch = borrow();
+                m_inbreeding[i] = inbreed(i, *scratch);
+            }
+            if (scratch) {
+                std::lock_guard<std::mutex> guard(lock);
+                spare.push_back(std::move(scratch));
+            }
+        });
+
+        start = end;
+    }
+}
+
+uint32_t Relatedness::position(PersonID id) const {
+    auto found = std::lower_bound(m_positions.begin(), m_positions.end(), std::make_pair(id, uint32_t(0)));
+    if (found == m_positions.end() || found->first != id) {
+        throw std::out_of_range("Person is not covered by this relatedness engine.");
+    }
+    return found->second;
+}
+
+/*
+One column of A = L D L' without L: solve up the pedigree from the person
+(each passes half to their parents), scale by D, then solve back down (each
+gets half of each parent). Everyone after the person in the numbering is
+zero on the way up, and nobody after last is needed on the way down.
+*/
+void Relatedness::column(uint32_t position, uint32_t last, double* work) const {
+    std::fill(work, work + last + 1, 0.0);
+    work[position] = 1.0;
+
+    for (uint32_t i = position + 1; i-- > 0;) {
+        if (work[i] == 0.0) continue;
+        double half = work[i] / 2;
+        if (m_mothers[i] != NONE) work[m_mothers[i]] += half;
+        if (m_fathers[i] != NONE) work[m_fathers[i]] += half;
+        work[i] *= m_variance[i];
+    }
+
+    for (uint32_t i = 0; i <= last; ++i) {
+        double parents = 0.0;
+        if (m_mothers[i] != NONE) parents += work[m_mothers[i]];
+        if (m_fathers[i] != NONE) parents += work[m_fathers[i]];
+        work[i] += parents / 2;
+    }
+}
+
+// Getter Functions
+double Relatedness::inbreeding(PersonID id) const {
+    return m_inbreeding[position(id)];
+}
+
+double Relatedness::kinship(PersonID a, PersonID b) const {
+    uint32_t pa = position(a);
+    uint32_t pb = position(b);
+    if (pa == pb) return (1.0 + m_inbreeding[pa]) / 2;
+
+    // The column of whoever comes later only has to reach the earlier one
+    if (pa < pb) std::swap(pa, pb);
+    std::vector<double> work(pa + 1);
+    column(pb, pa, work.data());
+    return work[pa] / 2;
+}
+
+double Relatedness::relationship(PersonID a, PersonID b) const {
+    double fa = inbreeding(a);
+    double fb = inbreeding(b);
+    return 2 * kinship(a, b) / std::sqrt((1.0 + fa) * (1.0 + fb));
+}
+
+std::vector<double> Relatedness::matrix(const PersonID* first, const PersonID* last, size_t budget) const {
+    size_t count = last - first;
+    size_t size = count * count * sizeof(double);
+    if (budget < size) {
+        throw std::length_error("Memory budget is too small for the kinship matrix.");
+    }
+
+    std::vector<double> result(count * count);
+    columns(first, last, budget - size, [&](size_t i, const double* kinships) {
+        std::copy(kinships, kinships + count, result.begin() + i * count);
+    });
+    return result;
+}
+
+size_t Relatedness::bytes() const {
+    return m_people.capacity() * sizeof(PersonID) + m_positions.capacity() * sizeof(m_positions[0])
+         + (m_mothers.capacity() + m_fathers.capacity()) * sizeof(uint32_t)
+         + (m_inbreeding.capacity() + m_variance.capacity()) * sizeof(double);
+}
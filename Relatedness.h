@@ -0,0 +1,116 @@
+#ifndef RELATEDNESS_H
+#define RELATEDNESS_H
+
+#include "Parallel.h"
+#include "PersonStore.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Wright's coefficients over a pedigree. Kinship is the chance that genes
+// drawn at random from two people are identical by descent; a person's
+// inbreeding is the kinship of their parents; and the coefficient of
+// relationship is twice the kinship, scaled down by both people's
+// inbreeding (1/2 for parents and full siblings, 1/8 for first cousins).
+//
+// An engine covers some people and all their ancestors, numbered in
+// generation order so everyone comes after their parents. Building it works
+// out everyone's inbreeding by Meuwissen and Luo's method, with each
+// person's ancestors bucketed by generation rather than kept in one sorted
+// list; the people of one generation, who cannot be each other's ancestors,
+// are spread over all cores. Kinship then comes a column at a time by
+// Colleau's indirect method, two passes over the numbering per person and
+// no stored matrix; columns() runs them in parallel blocks that fit a
+// memory budget. An engine over a few people costs only them and their
+// ancestors, not the size of the pool.
+class Relatedness {
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  // Member Variables
+  std::vector<PersonID> m_people;      // In generation order
+  std::vector<std::pair<PersonID, uint32_t>> m_positions;  // (ID, place in m_people), by ID
+  std::vector<uint32_t> m_mothers;     // Parents' places, or NONE
+  std::vector<uint32_t> m_fathers;
+  std::vector<double>   m_inbreeding;
+  std::vector<double>   m_variance;    // Mendelian sampling variance
+
+  // Helper Functions
+  void build(const PersonStore& store, const std::vector<uint32_t>& generations, std::vector<PersonID> people);
+  uint32_t position(PersonID id) const;
+  void column(uint32_t position, uint32_t last, double* work) const;
+
+public:
+  // Cover the whole pool, or [first, last) and their ancestors.
+  // generations is GenePool::generations() (or KinshipSolver::generations()).
+  Relatedness(const PersonStore& store, const std::vector<uint32_t>& generations);
+  Relatedness(const PersonStore& store, const std::vector<uint32_t>& generations, const PersonID* first, const PersonID* last);
+
+  // Everyone covered, in generation order.
+  const std::vector<PersonID>& people() const { return m_people; }
+
+  // The coefficients for covered people (std::out_of_range otherwise).
+  // Kinship and relationship take time linear in the people covered.
+  double inbreeding(PersonID id) const;
+  double kinship(PersonID a, PersonID b) const;
+  double relationship(PersonID a, PersonID b) const;
+
+  // Kinship between everyone in [first, last), a person at a time:
+  // visit(i, kinships) gets first[i]'s kinship with each of [first, last).
+  // Columns are worked out in parallel, as many at once as fit in budget
+  // bytes (std::length_error if not even one does); visit is only ever
+  // called from the calling thread, in order.
+  template <typename Visit>
+  void columns(const PersonID* first, const PersonID* last, size_t budget, Visit visit) const;
+
+  // The same as a row-major matrix; the result counts against budget.
+  std::vector<double> matrix(const PersonID* first, const PersonID* last, size_t budget) const;
+
+  // Approximate heap footprint.
+  size_t bytes() const;
+};
+
+template <typename Visit>
+void Relatedness::columns(const PersonID* first, const PersonID* last, size_t budget, Visit visit) const {
+  size_t count = last - first;
+  std::vector<uint32_t> rows(count);
+  uint32_t deepest = 0;
+  for (size_t i = 0; i < count; ++i) {
+    rows[i] = position(first[i]);
+    deepest = std::max(deepest, rows[i]);
+  }
+  if (count == 0) return;
+
+  // Each column in flight needs a work vector and its results:
+  size_t work = (size_t(deepest) + 1) * sizeof(double);
+  size_t each = work + count * sizeof(double);
+  if (budget < each) {
+    throw std::length_error("Memory budget is too small for one kinship column.");
+  }
+  size_t block = std::min(count, budget / each);
+  size_t threads = std::min<size_t>(workerCount(), block);
+  block = std::min(count, (budget - threads * work) / (count * sizeof(double)));
+
+  std::vector<double> results(block * count);
+  for (size_t start = 0; start < count; start += block) {
+    size_t size = std::min(block, count - start);
+    parallelFor(size, 1, [&](size_t lo, size_t hi) {
+      std::vector<double> scratch(deepest + 1);
+      for (size_t i = lo; i < hi; ++i) {
+        column(rows[start + i], deepest, scratch.data());
+        double* out = results.data() + i * count;
+        for (size_t j = 0; j < count; ++j) {
+          out[j] = scratch[rows[j]] / 2;
+        }
+      }
+    });
+
+    for (size_t i = 0; i < size; ++i) {
+      visit(start + i, static_cast<const double*>(results.data() + i * count));
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "RelationshipCache.h"
+// RelationshipCache Member Functions
+#include <algorithm>
+
+static uint32_t queryOf(Relationship relationship, PMod pmod, SMod smod) {
+    return static_cast<uint32_t>(relationship) << 16 | static_cast<uint32_t>(pmod) << 8 | static_cast<uint32_t>(smod);
+}
+
+// Constructor
+RelationshipCache::RelationshipCache(size_t budget) : m_budget(budget) {
+    for (size_t r = 0; r <= static_cast<size_t>(Relationship::UNCLES); ++r) {
+        Relationship relationship = static_cast<Relationship>(r);
+        m_shapeOf[r] = UINT8_MAX;
+        if (relationship == Relationship::EVERYONE) continue;
+
+        uint32_t up, down;
+        Plan::compile(relationship).reach(up, down);
+        size_t shape = 0;
+        while (shape < m_shapeCount && (m_shapes[shape].up != up || m_shapes[shape].down != down)) ++shape;
+        if (shape == m_shapeCount) {
+            m_shapes[shape].up = up;
+            m_shapes[shape].down = down;
+            ++m_shapeCount;
+        }
+        m_shapeOf[r] = static_cast<uint8_t>(shape);
+    }
+}
+
+// Helper Functions
+size_t RelationshipCache::cost(const Entry& entry) {
+    return sizeof(Entry) + entry.ids.capacity() * sizeof(PersonID) + 4 * sizeof(void*);
+}
+
+// Take an entry out of its person's list and free its slot (shard locked)
+void RelationshipCache::unlink(Shard& shard, uint32_t slot) {
+    Entry& entry = shard.entries[slot];
+    auto head = shard.heads.find(entry.person);
+    if (head->second == slot) {
+        if (entry.next == NONE) shard.heads.erase(head);
+        else head->second = entry.next;
+    }
+    else {
+        uint32_t previous = head->second;
+        while (shard.entries[previous].next != slot) previous = shard.entries[previous].next;
+        shard.entries[previous].next = entry.next;
+    }
+
+    shard.bytes -= cost(entry);
+    m_shapes[entry.shape].entries.fetch_sub(1, std::memory_order_relaxed);
+    m_shapes[entry.shape].ids.fetch_sub(entry.ids.size(), std::memory_order_relaxed);
+    std::vector<PersonID>().swap(entry.ids);
+    entry.live = false;
+    shard.free.push_back(slot);
+}
+
+// Advance the hand to the first entry not used since it last passed, and
+// evict that (shard locked, with at least one entry in it)
+void RelationshipCache::evict(Shard& shard) {
+    for (;;) {
+        if (shard.hand >= shard.entries.size()) shard.hand = 0;
+        Entry& entry = shard.entries[shard.hand];
+        uint32_t slot = static_cast<uint32_t>(shard.hand++);
+        if (!entry.live) continue;
+        if (entry.referenced) {
+            entry.referenced = false;
+            continue;
+        }
+        unlink(shard, slot);
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+// Drop a person's answers of one shape
+void RelationshipCache::drop(PersonID id, uint8_t shape) {
+    Shard& owner = shard(id);
+    std::lock_guard<std::mutex> guard(owner.lock);
+    auto head = owner.heads.find(id);
+    uint32_t slot = head == owner.heads.end() ? NONE : head->second;
+    while (slot != NONE) {
+        uint32_t next = owner.entries[slot].next;
+        if (owner.entries[slot].shape == shape) {
+            unlink(owner, slot);
+            owner.invalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot = next;
+    }
+}
+
+// Add everyone within levels generations above (or below) the people in
+// group to it, level by level so each is reached by their shortest path.
+// Everyone in group is marked with the current stamp. Gives up, returning
+// false, once group has more than limit people.
+bool RelationshipCache::climb(const PersonStore& store, std::vector<PersonID>& group, uint32_t levels, bool up, size_t limit) {
+    size_t first = 0;
+    auto visit = [&](PersonID id) {
+        if (id == NO_PERSON || m_marks[id] == m_stamp) return;
+        m_marks[id] = m_stamp;
+        group.push_back(id);
+    };
+    for (uint32_t i = 0; i < levels && first < group.size(); ++i) {
+        size_t last = group.size();
+        for (size_t k = first; k < last; ++k) {
+            PersonID id = group[k];
+            if (up) {
+                visit(store.mother(id));
+                visit(store.father(id));
+            }
+            else {
+                for (PersonID child : store.children(id)) visit(child);
+            }
+            if (group.size() > limit) return false;
+        }
+        first = last;
+    }
+    return true;
+}
+
+// Lookups
+bool RelationshipCache::find(PersonID id, Relationship relationship, PMod pmod, SMod smod, std::vector<PersonID>& out) {
+    Shard& owner = shard(id);
+    uint32_t query = queryOf(relationship, pmod, smod);
+    std::lock_guard<std::mutex> guard(owner.lock);
+
+    auto head = owner.heads.find(id);
+    for (uint32_t slot = head == owner.heads.end() ? NONE : head->second; slot != NONE; slot = owner.entries[slot].next) {
+        Entry& entry = owner.entries[slot];
+        if (entry.query != query) continue;
+        entry.referenced = true;
+        out.insert(out.end(), entry.ids.begin(), entry.ids.end());
+        owner.hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    owner.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void RelationshipCache::insert(PersonID id, Relationship relationship, PMod pmod, SMod smod, const PersonID* first, const PersonID* last) {
+    uint8_t shape = m_shapeOf[static_cast<size_t>(relationship)];
+    size_t limit = m_budget / SHARDS;
+    if (shape == UINT8_MAX || sizeof(Entry) + (last - first) * sizeof(PersonID) > limit) return;
+
+    Shard& owner = shard(id);
+    uint32_t query = queryOf(relationship, pmod, smod);
+    std::lock_guard<std::mutex> guard(owner.lock);
+
+    // Another thread may have got here first:
+    auto head = owner.heads.find(id);
+    uint32_t next = head == owner.heads.end() ? NONE : head->second;
+    for (uint32_t slot = next; slot != NONE; slot = owner.entries[slot].next) {
+        if (owner.entries[slot].query == query) return;
+    }
+
+    uint32_t slot;
+    if (!owner.free.empty()) {
+        slot = owner.free.back();
+        owner.free.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(owner.entries.size());
+        owner.entries.emplace_back();
+    }
+
+    Entry& entry = owner.entries[slot];
+    entry.ids.assign(first, last);
+    entry.person = id;
+    entry.next = next;
+    entry.query = query;
+    entry.shape = shape;
+    entry.live = true;
+    entry.referenced = false;
+    owner.heads[id] = slot;
+    owner.bytes += cost(entry);
+    m_shapes[shape].entries.fetch_add(1, std::memory_order_relaxed);
+    m_shapes[shape].ids.fetch_add(entry.ids.size(), std::memory_order_relaxed);
+    owner.inserts.fetch_add(1, std::memory_order_relaxed);
+
+    // The new entry is unreferenced, so the hand may take it too if it is
+    // the only one left to take:
+    while (owner.bytes > limit) evict(owner);
+}
+
+/*
+An answer from p changes only if its plan passes one of the touched people
+t: climbing i <= up generations from p and then descending j <= down gets
+to t. So, per shape, climb down generations from each t and then descend
+up generations from there; everyone reached may have a stale answer. When
+that is more people than the shape has answers cached, it is cheaper to
+check each cached answer against them instead.
+
+The closures have no bound, and an edit high in the tree reaches a lot of
+people. But a closure's answer is everyone its walk passed, so once the
+climb has found more people than those answers hold IDs, look for the
+touched people in the answers themselves.
+*/
+void RelationshipCache::invalidate(const PersonStore& store, const PersonID* first, const PersonID* last) {
+    std::vector<PersonID> touched;
+    for (const PersonID* id = first; id != last; ++id) {
+        if (*id != NO_PERSON && std::find(touched.begin(), touched.end(), *id) == touched.end()) touched.push_back(*id);
+    }
+    if (m_marks.size() < store.size()) m_marks.resize(store.size(), 0);
+
+    // Start a new set of reached people, with just the touched ones in it:
+    std::vector<PersonID> reached;
+    auto restart = [&]() {
+        if (++m_stamp == 0) {
+            std::fill(m_marks.begin(), m_marks.end(), 0);
+            m_stamp = 1;
+        }
+        reached = touched;
+        for (PersonID id : touched) m_marks[id] = m_stamp;
+    };
+
+    // Drop the answers of one shape that stale() picks:
+    auto sweep = [&](uint8_t shape, auto stale) {
+        for (Shard& owner : m_shards) {
+            std::lock_guard<std::mutex> guard(owner.lock);
+            for (uint32_t slot = 0; slot < owner.entries.size(); ++slot) {
+                const Entry& entry = owner.entries[slot];
+                if (entry.live && entry.shape == shape && stale(entry)) {
+                    unlink(owner, slot);
+                    owner.invalidations.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+    auto marked = [&](PersonID id) { return m_marks[id] == m_stamp; };
+
+    for (size_t s = 0; s < m_shapeCount; ++s) {
+        const Shape& shape = m_shapes[s];
+        uint8_t index = static_cast<uint8_t>(s);
+        size_t cached = shape.entries.load(std::memory_order_relaxed);
+        if (cached == 0) continue;
+
+        bool closure = shape.up == UINT32_MAX || shape.down == UINT32_MAX;
+        size_t limit = closure ? shape.ids.load(std::memory_order_relaxed) : SIZE_MAX;
+        restart();
+        if (!climb(store, reached, shape.down, true, limit) || !climb(store, reached, shape.up, false, limit)) {
+            restart();
+            sweep(index, [&](const Entry& entry) {
+                return marked(entry.person) || std::any_of(entry.ids.begin(), entry.ids.end(), marked);
+            });
+        }
+        else if (reached.size() <= cached) {
+            for (PersonID id : reached) drop(id, index);
+        }
+        else {
+            sweep(index, [&](const Entry& entry) { return marked(entry.person); });
+        }
+    }
+}
+
+void RelationshipCache::clear() {
+    for (Shard& owner : m_shards) {
+        std::lock_guard<std::mutex> guard(owner.lock);
+        owner.heads.clear();
+        owner.entries.clear();
+        owner.free.clear();
+        owner.hand = 0;
+        owner.bytes = 0;
+    }
+    for (size_t s = 0; s < m_shapeCount; ++s) {
+        m_shapes[s].entries.store(0, std::memory_order_relaxed);
+        m_shapes[s].ids.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Getter Functions
+RelationshipCache::Stats RelationshipCache::stats() const {
+    Stats result;
+    for (const Shard& owner : m_shards) {
+        std::lock_guard<std::mutex> guard(owner.lock);
+        result.hits += owner.hits.load(std::memory_order_relaxed);
+        result.misses += owner.misses.load(std::memory_order_relaxed);
+        result.inserts += owner.inserts.load(std::memory_order_relaxed);
+        result.evictions += owner.evictions.load(std::memory_order_relaxed);
+        result.invalidations += owner.invalidations.load(std::memory_order_relaxed);
+        result.entries += owner.entries.size() - owner.free.size();
+        result.bytes += owner.bytes;
+    }
+    return result;
+}
+
+size_t RelationshipCache::bytes() const {
+    size_t result = sizeof(*this) + m_marks.capacity() * sizeof(uint32_t);
+    for (const Shard& owner : m_shards) {
+        std::lock_guard<std::mutex> guard(owner.lock);
+        size_t live = owner.entries.size() - owner.free.size();
+        result += owner.bytes + (owner.entries.capacity() - live) * sizeof(Entry) + owner.free.capacity() * sizeof(uint32_t);
+    }
+    return result;
+}
@@ -0,0 +1,134 @@
+#ifndef RELATIONSHIPCACHE_H
+#define RELATIONSHIPCACHE_H
+
+#include "Plan.h"
+#include "PersonStore.h"
+#include "Roles.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Answers to one person's relationship queries, kept for when they are
+// asked again. Entries are keyed by (person, relationship, pmod, smod) and
+// hold the answer's IDs as Plan::expand() gave them: unsorted, maybe with
+// repeats, so a miss costs one copy and a hit is sorted along with the
+// rest of the hop's results, as a fresh answer would be.
+//
+// The cache is split into shards by person, each with its own lock and an
+// equal part of the byte budget. A full shard evicts with CLOCK: a hand
+// sweeps the entries, sparing those used since it last passed once, so hot
+// answers stay while one-off ones make room.
+//
+// Edits keep the cache exact. Each plan climbs at most `up` generations
+// and then descends at most `down` (see Plan::reach()), so an answer can
+// only change if someone within that reach gets new parents or children.
+// invalidate() runs the same reach backwards from the people an edit
+// touches, on the links as they were, and drops just the answers that
+// could have seen them: descendants' ancestors, ancestors' descendants,
+// siblings' and cousins' families, and so on.
+//
+// Lookups and inserts may come from many threads at once; invalidate() and
+// clear() need the pool to themselves, as edits do.
+class RelationshipCache {
+public:
+  struct Stats {
+    uint64_t hits          = 0;
+    uint64_t misses        = 0;
+    uint64_t inserts       = 0;
+    uint64_t evictions     = 0;  // To stay within the budget
+    uint64_t invalidations = 0;  // By edits
+    size_t   entries       = 0;
+    size_t   bytes         = 0;
+
+    double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0; }
+  };
+
+private:
+  static const size_t SHARDS = 16;
+  static const uint32_t NONE = UINT32_MAX;
+
+  struct Entry {
+    std::vector<PersonID> ids;
+    PersonID person;
+    uint32_t next;        // The person's next entry, or NONE
+    uint32_t query;       // Relationship, pmod and smod
+    uint8_t  shape;       // Index into m_shapes
+    bool     live;
+    bool     referenced;  // Used since the hand last passed
+  };
+
+  struct alignas(64) Shard {
+    mutable std::mutex lock;
+    std::unordered_map<PersonID, uint32_t> heads;  // First entry of each person
+    std::vector<Entry>    entries;
+    std::vector<uint32_t> free;
+    size_t hand  = 0;
+    size_t bytes = 0;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> invalidations{0};
+  };
+
+  // How far a relationship's plan reaches.
+  struct Shape {
+    uint32_t up;
+    uint32_t down;
+    std::atomic<size_t> entries{0};
+    std::atomic<size_t> ids{0};      // In those entries
+  };
+
+  // Member Variables
+  size_t  m_budget;
+  Shard   m_shards[SHARDS];
+  Shape   m_shapes[static_cast<size_t>(Relationship::UNCLES) + 1];
+  uint8_t m_shapeOf[static_cast<size_t>(Relationship::UNCLES) + 1];
+  size_t  m_shapeCount = 0;
+
+  // Scratch for invalidate(): people marked with the current stamp have
+  // been reached.
+  std::vector<uint32_t> m_marks;
+  uint32_t m_stamp = 0;
+
+  // Helper Functions
+  Shard& shard(PersonID id) { return m_shards[(id * 0x9E3779B1u) >> 28]; }
+  static size_t cost(const Entry& entry);
+  void unlink(Shard& shard, uint32_t slot);
+  void evict(Shard& shard);
+  void drop(PersonID id, uint8_t shape);
+  bool climb(const PersonStore& store, std::vector<PersonID>& group, uint32_t levels, bool up, size_t limit);
+
+public:
+  // Keep answers up to budget bytes in all, IDs and bookkeeping included.
+  explicit RelationshipCache(size_t budget);
+
+  RelationshipCache(const RelationshipCache& other) = delete;
+  RelationshipCache& operator = (const RelationshipCache& other) = delete;
+
+  // Append the cached answer to out and return true, or return false.
+  bool find(PersonID id, Relationship relationship, PMod pmod, SMod smod, std::vector<PersonID>& out);
+
+  // Remember an answer. EVERYONE is not cached, nor is an answer too big
+  // for its shard.
+  void insert(PersonID id, Relationship relationship, PMod pmod, SMod smod, const PersonID* first, const PersonID* last);
+
+  // Call before the parents of the people in [first, last) change (NO_PERSON
+  // is skipped), with store still as it was: list each edited child and
+  // their old and new parents. Drops every answer the edit could change.
+  void invalidate(const PersonStore& store, const PersonID* first, const PersonID* last);
+
+  // Forget everything; the counters carry on.
+  void clear();
+
+  // Getter Functions
+  Stats stats() const;
+  size_t bytes() const;  // Everything held, free slots and scratch included
+  size_t budget() const { return m_budget; }
+};
+
+#endif
@@ -2,7 +2,7 @@
 #define ROLES_H
 
 // Genders
-enum class Gender {
+enum class Gender : unsigned char {
   MALE,
   FEMALE,
   ANY
@@ -0,0 +1,241 @@
+#include "Snapshot.h"
+// Snapshot Functions
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const char     MAGIC[8]   = {'G', 'E', 'N', 'E', 'P', 'O', 'O', 'L'};
+static const uint32_t ORDER_MARK = 0x01020304;
+static const uint64_t ALIGNMENT  = 64;    // What readers need
+static const uint64_t PAGE       = 4096;  // What writers give
+
+// A fast 64-bit checksum: eight bytes per multiply, then the odd tail.
+static uint64_t checksum(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t result = 0x9E3779B97F4A7C15ull ^ size;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        result = (result ^ word) * 0xFF51AFD7ED558CCDull;
+        result ^= result >> 32;
+    }
+    for (; i < size; ++i) {
+        result = (result ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return result;
+}
+
+static uint64_t headerChecksum(SnapshotHeader header, const SnapshotSection* table) {
+    header.checksum = 0;
+    uint64_t result = checksum(&header, sizeof(header));
+    return result ^ checksum(table, header.sections * sizeof(SnapshotSection));
+}
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + PAGE - 1) / PAGE * PAGE;
+}
+
+// Section i of a snapshot: the store's columns, then the name index's
+// arrays, then the LCA index's
+static std::pair<const void*, size_t> section(const PersonStore& store, const NameIndex& index, const LCAIndex* lca, uint32_t i) {
+    if (i < PersonStore::SECTIONS) return store.section(static_cast<PersonStore::Section>(i));
+    if (i < SNAPSHOT_SECTIONS) return index.section(static_cast<NameIndex::Section>(i - PersonStore::SECTIONS));
+    return lca->section(static_cast<LCAIndex::Section>(i - SNAPSHOT_SECTIONS));
+}
+
+bool isSnapshot(const char* data, size_t size) {
+    return size >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void saveSnapshot(const PersonStore& store, const NameIndex& index, const LCAIndex* lca, const char* path) {
+    SnapshotHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version   = SNAPSHOT_VERSION;
+    header.byteOrder = ORDER_MARK;
+    header.people    = store.size();
+    header.sections  = lca != nullptr ? SNAPSHOT_LCA_SECTIONS : SNAPSHOT_SECTIONS;
+    header.reserved  = 0;
+
+    SnapshotSection table[SNAPSHOT_LCA_SECTIONS];
+    uint64_t tableSize = header.sections * sizeof(SnapshotSection);
+    uint64_t offset = alignUp(sizeof(header) + tableSize);
+    for (uint32_t i = 0; i < header.sections; ++i) {
+        auto data = section(store, index, lca, i);
+        table[i].offset   = offset;
+        table[i].size     = data.second;
+        table[i].checksum = checksum(data.first, data.second);
+        offset = alignUp(offset + data.second);
+    }
+    header.checksum = headerChecksum(header, table);
+
+    std::string temporary = std::string(path) + ".tmp";
+    std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Cannot write snapshot: " + temporary);
+    }
+
+    static const char padding[PAGE] = {};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(table), tableSize);
+    uint64_t written = sizeof(header) + tableSize;
+    for (uint32_t i = 0; i < header.sections; ++i) {
+        stream.write(padding, table[i].offset - written);
+        auto data = section(store, index, lca, i);
+        stream.write(static_cast<const char*>(data.first), data.second);
+        written = table[i].offset + data.second;
+    }
+
+    stream.close();
+    if (!stream || std::rename(temporary.c_str(), path) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot write snapshot: " + std::string(path));
+    }
+}
+
+// Is every ID in a section someone in the pool (or, if none is allowed,
+// NO_PERSON)?
+static bool validIDs(const std::pair<const void*, size_t>& section, uint64_t people, bool none) {
+    const PersonID* ids = static_cast<const PersonID*>(section.first);
+    size_t count = section.second / sizeof(PersonID);
+    bool valid = true;
+    for (size_t i = 0; i < count; ++i) {
+        valid &= ids[i] < people || (none && ids[i] == NO_PERSON);
+    }
+    return valid;
+}
+
+// Do a section's offsets never go down (so each range lies inside the
+// column their last entry has been checked against)?
+template <typename T>
+static bool ascending(const std::pair<const void*, size_t>& section) {
+    const T* offsets = static_cast<const T*>(section.first);
+    size_t count = section.second / sizeof(T);
+    bool valid = true;
+    for (size_t i = 1; i < count; ++i) {
+        valid &= offsets[i - 1] <= offsets[i];
+    }
+    return valid;
+}
+
+/*
+Everything needed to use the columns safely is checked up front: in O(1),
+the header, every section lying inside the file and aligned, and the column
+sizes agreeing with the people count and with each other; then, in one pass
+over each, every ID a query can follow and every offset it can read from.
+Names in the perfect-hash index are checked as they are looked up. A cycle
+of parents would take the whole pedigree in memory to find, so only the
+checksums catch one.
+*/
+void openSnapshot(std::shared_ptr<const MappedFile> file, PersonStore& store, NameIndex& index, std::unique_ptr<LCAIndex>& lca, bool verify) {
+    const char* data = file->data();
+    size_t size = file->size();
+
+    SnapshotHeader header;
+    if (!isSnapshot(data, size) || size < sizeof(header)) {
+        throw std::runtime_error("Not a snapshot.");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.byteOrder != ORDER_MARK) {
+        throw std::runtime_error("Snapshot was written with a different byte order.");
+    }
+    if (header.version != SNAPSHOT_VERSION && header.version != 2) {
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version) + ".");
+    }
+    bool hasLCA = header.version == SNAPSHOT_VERSION && header.sections == SNAPSHOT_LCA_SECTIONS;
+    if ((header.sections != SNAPSHOT_SECTIONS && !hasLCA) || size < sizeof(header) + sizeof(SnapshotSection) * header.sections) {
+        throw std::runtime_error("Snapshot section table is damaged.");
+    }
+
+    std::vector<SnapshotSection> table(header.sections);
+    std::memcpy(table.data(), data + sizeof(header), sizeof(SnapshotSection) * header.sections);
+    if (headerChecksum(header, table.data()) != header.checksum) {
+        throw std::runtime_error("Snapshot header checksum mismatch.");
+    }
+
+    // Checking reads the link columns, and verifying every byte, front to back
+    file->advise(data, size, Access::SEQUENTIAL);
+    std::pair<const void*, size_t> sections[SNAPSHOT_LCA_SECTIONS];
+    for (uint32_t i = 0; i < header.sections; ++i) {
+        const SnapshotSection& section = table[i];
+        if (section.offset % ALIGNMENT != 0 || section.offset > size || section.size > size - section.offset) {
+            throw std::runtime_error("Snapshot section " + std::to_string(i) + " is out of bounds.");
+        }
+        if (verify && checksum(data + section.offset, section.size) != section.checksum) {
+            throw std::runtime_error("Snapshot section " + std::to_string(i) + " checksum mismatch.");
+        }
+        sections[i] = std::make_pair(data + section.offset, section.size);
+    }
+
+    uint64_t people = header.people;
+    auto expect = [&](PersonStore::Section section, uint64_t bytes) {
+        if (sections[section].second != bytes) {
+            throw std::runtime_error("Snapshot section " + std::to_string(section) + " has the wrong size.");
+        }
+    };
+    expect(PersonStore::NAME_OFFSETS, (people + 1) * sizeof(uint64_t));
+    expect(PersonStore::GENDERS, people * sizeof(Gender));
+    expect(PersonStore::MOTHERS, people * sizeof(PersonID));
+    expect(PersonStore::FATHERS, people * sizeof(PersonID));
+    expect(PersonStore::CHILD_OFFSETS, (people + 1) * sizeof(uint32_t));
+
+    const uint64_t* nameOffsets  = static_cast<const uint64_t*>(sections[PersonStore::NAME_OFFSETS].first);
+    const uint32_t* childOffsets = static_cast<const uint32_t*>(sections[PersonStore::CHILD_OFFSETS].first);
+    expect(PersonStore::NAME_CHARS, nameOffsets[people]);
+    expect(PersonStore::CHILD_IDS, uint64_t(childOffsets[people]) * sizeof(PersonID));
+
+    const auto* names = sections + PersonStore::SECTIONS;
+    if (names[NameIndex::BUCKETS].second % sizeof(uint32_t) != 0 ||
+        names[NameIndex::SLOTS].second > people * sizeof(PersonID) ||
+        names[NameIndex::SLOTS].second % sizeof(PersonID) != 0) {
+        throw std::runtime_error("Snapshot name index has the wrong size.");
+    }
+
+    const auto* lines = sections + SNAPSHOT_SECTIONS;
+    if (hasLCA) {
+        for (LCAIndex::Section depths : {LCAIndex::MATERNAL_DEPTHS, LCAIndex::PATERNAL_DEPTHS}) {
+            const auto& jumps = lines[depths + 1];
+            if (lines[depths].second != people * sizeof(uint32_t) ||
+                (people != 0 && (jumps.second == 0 || jumps.second % (people * sizeof(PersonID)) != 0))) {
+                throw std::runtime_error("Snapshot LCA index has the wrong size.");
+            }
+        }
+    }
+
+    if (!ascending<uint64_t>(sections[PersonStore::NAME_OFFSETS]) ||
+        !ascending<uint32_t>(sections[PersonStore::CHILD_OFFSETS]) ||
+        !validIDs(sections[PersonStore::MOTHERS], people, true) ||
+        !validIDs(sections[PersonStore::FATHERS], people, true) ||
+        !validIDs(sections[PersonStore::CHILD_IDS], people, false)) {
+        throw std::runtime_error("Snapshot columns are damaged.");
+    }
+    if (hasLCA) {
+        for (LCAIndex::Section depths : {LCAIndex::MATERNAL_DEPTHS, LCAIndex::PATERNAL_DEPTHS}) {
+            // Depths must fit in the jumps there are
+            const uint32_t* depth = static_cast<const uint32_t*>(lines[depths].first);
+            uint64_t levels = people == 0 ? 0 : lines[depths + 1].second / (people * sizeof(PersonID));
+            bool valid = true;
+            for (uint64_t i = 0; i < people; ++i) {
+                valid &= levels >= 32 || depth[i] < (uint64_t(1) << levels);
+            }
+            if (!valid || !validIDs(lines[depths + 1], people, true)) {
+                throw std::runtime_error("Snapshot LCA index is damaged.");
+            }
+        }
+    }
+
+    // Queries read a few people's entries here and there, so only read the
+    // pages they are on
+    file->advise(data, size, Access::RANDOM);
+
+    store.view(sections, file);
+    if (hasLCA) {
+        lca.reset(new LCAIndex(people, lines, file));
+    }
+    index.view(names, std::move(file));
+}
@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "LCAIndex.h"
+#include "Loading.h"
+#include "NameIndex.h"
+#include "PersonStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Binary snapshots of a PersonStore.
+//
+// A snapshot is a header, a table of sections and then the store's columns
+// (PersonStore::Section order) followed by the name index's perfect hash
+// (NameIndex::Section order) and, if one was built, the LCA index's arrays
+// (LCAIndex::Section order), each stored exactly as they sit in memory, so
+// a mapped snapshot is used in place. Integers are in the writer's byte
+// order, which the header records. The header and table are checksummed,
+// and so is every section.
+//
+// Sections start on 4 KB pages (files from before only promise 64 bytes),
+// so no page holds the end of one section and the start of the next. A
+// pool on a snapshot only needs the pages its queries touch in memory (the
+// link columns are read once on open to check them, but need not stay),
+// and the OS pages them in and out, so pools larger than RAM work. Saving
+// people in FAMILIES order keeps the pages a query touches few.
+struct SnapshotHeader {
+  char     magic[8];    // "GENEPOOL"
+  uint32_t version;
+  uint32_t byteOrder;   // 0x01020304 as the writer stored it
+  uint64_t people;
+  uint32_t sections;
+  uint32_t reserved;
+  uint64_t checksum;    // Header (with this field zeroed) and section table
+};
+
+struct SnapshotSection {
+  uint64_t offset;
+  uint64_t size;
+  uint64_t checksum;
+};
+
+const uint32_t SNAPSHOT_VERSION = 3;  // Version 2 files (no LCA index) still open
+const uint32_t SNAPSHOT_SECTIONS = PersonStore::SECTIONS + NameIndex::SECTIONS;
+const uint32_t SNAPSHOT_LCA_SECTIONS = SNAPSHOT_SECTIONS + LCAIndex::SECTIONS;
+
+// The order people are saved in. Snapshots in FAMILIES order number people
+// generation by generation, children grouped by their parents' places, so
+// siblings, cousins and parents sit on nearby pages of every column.
+enum class PersonOrder {
+  LOADED,    // As the pool has them
+  FAMILIES   // Families together
+};
+
+// Does this buffer start like a snapshot?
+bool isSnapshot(const char* data, size_t size);
+
+// Write a store, a perfect-hash index of its names (see NameIndex::perfect())
+// and optionally an LCA index to path, through a temporary file renamed
+// into place.
+void saveSnapshot(const PersonStore& store, const NameIndex& index, const LCAIndex* lca, const char* path);
+
+// Point a store and index at the sections of a mapped snapshot, keeping the
+// file mapped for as long as they use it, and open its LCA index into lca
+// if it has one. The file is advised RANDOM (SEQUENTIAL while checking),
+// so faults read no more than the page they are for. The header, section
+// table and column sizes are always checked, and so is every parent, child
+// and offset in the link columns (one pass over each), so queries never
+// read outside the file. With verify, every section's checksum is too
+// (which reads the whole file, and catches what the checks cannot, such as
+// a cycle of parents). Throws std::runtime_error if malformed.
+void openSnapshot(std::shared_ptr<const MappedFile> file, PersonStore& store, NameIndex& index, std::unique_ptr<LCAIndex>& lca, bool verify);
+
+#endif
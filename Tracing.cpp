@@ -0,0 +1,122 @@
+#include "Tracing.h"
+// Tracing Functions
+#include <algorithm>
+#include <string>
+
+namespace {
+    const size_t RELATIONSHIPS = static_cast<size_t>(Relationship::UNCLES) + 1;
+
+    Trace::Histogram parses;
+    Trace::Histogram queries;
+    Trace::Histogram kinships;
+    Trace::Histogram hops[RELATIONSHIPS];
+
+    double per(uint64_t total, uint64_t count) {
+        return count == 0 ? 0 : static_cast<double>(total) / static_cast<double>(count);
+    }
+}
+
+Trace::Counters& Trace::local() {
+    thread_local Counters counters;
+    return counters;
+}
+
+Trace::Histogram& Trace::histogram(Kind kind, Relationship relationship) {
+    switch (kind) {
+        case Kind::PARSE:   return parses;
+        case Kind::QUERY:   return queries;
+        case Kind::KINSHIP: return kinships;
+        case Kind::HOP:     break;
+    }
+    return hops[static_cast<size_t>(relationship)];
+}
+
+// Histogram Member Functions
+// Below 4 ns a bucket per value; above, the exponent and the two bits
+// after the leading one.
+size_t Trace::Histogram::bucket(uint64_t nanos) {
+    if (nanos < 4) return static_cast<size_t>(nanos);
+    unsigned exponent = 63 - __builtin_clzll(nanos);
+    size_t index = 4 * exponent + ((nanos >> (exponent - 2)) & 3);
+    return std::min(index, BUCKETS - 1);
+}
+
+uint64_t Trace::Histogram::upper(size_t bucket) {
+    if (bucket < 4) return bucket;
+    unsigned exponent = static_cast<unsigned>(bucket / 4);
+    return ((5 + bucket % 4) << (exponent - 2)) - 1;
+}
+
+void Trace::Histogram::record(uint64_t nanos, uint64_t visited, uint64_t sets, uint64_t results) {
+    m_buckets[bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_nanos.fetch_add(nanos, std::memory_order_relaxed);
+    m_visited.fetch_add(visited, std::memory_order_relaxed);
+    m_sets.fetch_add(sets, std::memory_order_relaxed);
+    m_results.fetch_add(results, std::memory_order_relaxed);
+
+    uint64_t seen = m_max.load(std::memory_order_relaxed);
+    while (seen < nanos && !m_max.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {}
+}
+
+void Trace::Histogram::reset() {
+    for (std::atomic<uint64_t>& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>* total : {&m_count, &m_nanos, &m_max, &m_visited, &m_sets, &m_results}) {
+        total->store(0, std::memory_order_relaxed);
+    }
+}
+
+double Trace::Histogram::mean() const {
+    return per(m_nanos.load(std::memory_order_relaxed), count());
+}
+
+// The first bucket at which the running count reaches p of the total
+uint64_t Trace::Histogram::percentile(double p) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(p * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) return std::min(upper(i), max());
+    }
+    return max();
+}
+
+double Trace::Histogram::visited() const {
+    return per(m_visited.load(std::memory_order_relaxed), count());
+}
+
+double Trace::Histogram::sets() const {
+    return per(m_sets.load(std::memory_order_relaxed), count());
+}
+
+double Trace::Histogram::results() const {
+    return per(m_results.load(std::memory_order_relaxed), count());
+}
+
+// Reports
+void Trace::dump(std::ostream& out) {
+    out << "kind\tcount\tmean_us\tp50_us\tp90_us\tp99_us\tmax_us\tvisited\tsets\tresults\n";
+    auto row = [&](const std::string& name, const Histogram& histogram) {
+        if (histogram.count() == 0) return;
+        out << name << '\t' << histogram.count() << '\t' << histogram.mean() / 1000 << '\t'
+            << histogram.percentile(0.50) / 1000.0 << '\t' << histogram.percentile(0.90) / 1000.0 << '\t'
+            << histogram.percentile(0.99) / 1000.0 << '\t' << histogram.max() / 1000.0 << '\t'
+            << histogram.visited() << '\t' << histogram.sets() << '\t' << histogram.results() << '\n';
+    };
+
+    row("parse", parses);
+    row("query", queries);
+    row("kinship", kinships);
+    for (size_t r = 0; r < RELATIONSHIPS; ++r) {
+        row(std::string("hop:") + to_string(static_cast<Relationship>(r)), hops[r]);
+    }
+}
+
+void Trace::reset() {
+    parses.reset();
+    queries.reset();
+    kinships.reset();
+    for (Histogram& histogram : hops) histogram.reset();
+}
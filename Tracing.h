@@ -0,0 +1,125 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include "Plan.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Optional instrumentation of queries, compiled in with -DGENEPOOL_TRACE.
+// Without it TRACING is false, every hook below is an empty inline
+// function, and the optimizer removes them along with the clock reads
+// around them; the code is still compiled either way, so it cannot rot.
+//
+// The hot paths count into the calling thread's counters: people visited
+// (each person a plan step expands, and everyone a closure walk reaches)
+// and person-set buffers allocated. Queries then add their latency and
+// those counts to histograms: one per relationship for the hops of any
+// query, and one each for parsing, whole queries and kinship questions.
+// Histograms are lock-free, so threads record in parallel, and dump()
+// prints them whenever asked.
+namespace Trace {
+
+#if defined(GENEPOOL_TRACE)
+constexpr bool TRACING = true;
+#else
+constexpr bool TRACING = false;
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// What the calling thread has done so far.
+struct Counters {
+  uint64_t visited = 0;
+  uint64_t sets    = 0;
+};
+
+Counters& local();
+
+inline void visit(uint64_t people) {
+  if constexpr (TRACING) local().visited += people;
+}
+
+inline void allocate() {
+  if constexpr (TRACING) ++local().sets;
+}
+
+// Latencies in buckets four to a power of two (each about 19% wide), from
+// 1 ns to over a minute, plus totals for the means.
+class Histogram {
+public:
+  static const size_t BUCKETS = 4 * 37;
+
+private:
+  // Member Variables
+  std::atomic<uint64_t> m_buckets[BUCKETS] = {};
+  std::atomic<uint64_t> m_count{0};
+  std::atomic<uint64_t> m_nanos{0};
+  std::atomic<uint64_t> m_max{0};
+  std::atomic<uint64_t> m_visited{0};
+  std::atomic<uint64_t> m_sets{0};
+  std::atomic<uint64_t> m_results{0};
+
+  static size_t bucket(uint64_t nanos);
+  static uint64_t upper(size_t bucket);
+
+public:
+  void record(uint64_t nanos, uint64_t visited, uint64_t sets, uint64_t results);
+  void reset();
+
+  // Getter Functions
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  double mean() const;
+  uint64_t percentile(double p) const;  // An upper bound, in ns
+  uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+  double visited() const;               // Means per record
+  double sets() const;
+  double results() const;
+};
+
+// What to record a measurement under.
+enum class Kind : unsigned char {
+  PARSE,    // Query and kinship parsing
+  QUERY,    // Whole query runs
+  KINSHIP,  // "How is X related to Y?" runs
+  HOP,      // One relationship hop of a query
+};
+
+Histogram& histogram(Kind kind, Relationship relationship = Relationship::EVERYONE);
+
+// Times one piece of work on this thread, with the counts it added, and
+// records it when done() is called.
+class Span {
+  Clock::time_point m_start;
+  Counters          m_before;
+
+public:
+  Span() {
+    if constexpr (TRACING) {
+      m_before = local();
+      m_start = Clock::now();
+    }
+  }
+
+  void done(Kind kind, uint64_t results, Relationship relationship = Relationship::EVERYONE) const {
+    if constexpr (TRACING) {
+      uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+      const Counters& now = local();
+      histogram(kind, relationship).record(nanos, now.visited - m_before.visited, now.sets - m_before.sets, results);
+    }
+  }
+};
+
+// One row per histogram with anything in it: count, mean, p50, p90, p99
+// and max latency in microseconds, then people visited, sets allocated
+// and results per record. TSV, with a header line.
+void dump(std::ostream& out);
+
+// Empty every histogram.
+void reset();
+
+}
+
+#endif
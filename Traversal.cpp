@@ -0,0 +1,73 @@
+#include "Traversal.h"
+// Traversal Member Functions
+#include "Tracing.h"
+
+Traversal& Traversal::local() {
+    thread_local Traversal traversal;
+    return traversal;
+}
+
+// Make sure the bitset covers every ID and start from an empty walk.
+void Traversal::prepare(const PersonStore& store) {
+    size_t words = (store.size() + 63) / 64;
+    if (m_visited.size() < words) {
+        m_visited.resize(words, 0);
+    }
+    m_stack.clear();
+    m_reached.clear();
+}
+
+// Queue a person unless they have already been reached in this walk.
+void Traversal::push(PersonID id) {
+    if (id == NO_PERSON) return;
+
+    uint64_t& word = m_visited[id >> 6];
+    uint64_t bit = uint64_t(1) << (id & 63);
+    if (word & bit) return;
+
+    word |= bit;
+    m_reached.push_back(id);
+    m_stack.push_back(id);
+}
+
+// Clear only the bits this walk set, so the next one starts clean in O(reached).
+void Traversal::finish() {
+    Trace::visit(m_reached.size());
+    for (PersonID id : m_reached) {
+        m_visited[id >> 6] &= ~(uint64_t(1) << (id & 63));
+    }
+}
+
+std::vector<PersonID>& Traversal::ancestors(const PersonStore& store, PersonID start, PMod pmod) {
+    prepare(store);
+    if (pmod == PMod::ANY || pmod == PMod::MATERNAL) push(store.mother(start));
+    if (pmod == PMod::ANY || pmod == PMod::PATERNAL) push(store.father(start));
+
+    while (!m_stack.empty()) {
+        PersonID id = m_stack.back();
+        m_stack.pop_back();
+        push(store.mother(id));
+        push(store.father(id));
+    }
+
+    finish();
+    return m_reached;
+}
+
+std::vector<PersonID>& Traversal::descendants(const PersonStore& store, PersonID start) {
+    prepare(store);
+    for (PersonID child : store.children(start)) {
+        push(child);
+    }
+
+    while (!m_stack.empty()) {
+        PersonID id = m_stack.back();
+        m_stack.pop_back();
+        for (PersonID child : store.children(id)) {
+            push(child);
+        }
+    }
+
+    finish();
+    return m_reached;
+}
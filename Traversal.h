@@ -0,0 +1,91 @@
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include "PersonStore.h"
+#include "Roles.h"
+#include <cstdint>
+#include <vector>
+
+// Iterative closure walks over a PersonStore.
+// Each walk uses an explicit stack and a visited bitset over person IDs, so
+// it runs in time proportional to the people it reaches, never recurses,
+// and visits a shared ancestor (pedigree collapse) only once.
+class Traversal {
+  // Member Variables
+  std::vector<uint64_t> m_visited;
+  std::vector<PersonID> m_stack;
+  std::vector<PersonID> m_reached;
+
+  // Helper Functions
+  void prepare(const PersonStore& store);
+  void push(PersonID id);
+  void finish();
+
+public:
+  // A traversal for the calling thread, reused between walks.
+  static Traversal& local();
+
+  // Everyone reachable through parent links. Only the first step follows pmod.
+  // The returned IDs are in no particular order and are only valid until the
+  // next walk on this Traversal.
+  std::vector<PersonID>& ancestors(const PersonStore& store, PersonID start, PMod pmod = PMod::ANY);
+
+  // Everyone reachable through child links. Same rules as ancestors().
+  std::vector<PersonID>& descendants(const PersonStore& store, PersonID start);
+
+  // Search child links from start for someone where found(id) holds,
+  // without expanding past anyone where prune(id) holds.
+  template <typename Found, typename Prune>
+  bool search(const PersonStore& store, PersonID start, Found found, Prune prune);
+
+  // The same over parent links.
+  template <typename Found, typename Prune>
+  bool searchUp(const PersonStore& store, PersonID start, Found found, Prune prune);
+};
+
+template <typename Found, typename Prune>
+bool Traversal::search(const PersonStore& store, PersonID start, Found found, Prune prune) {
+  prepare(store);
+  push(start);
+
+  bool result = false;
+  while (!m_stack.empty() && !result) {
+    PersonID id = m_stack.back();
+    m_stack.pop_back();
+    if (id != start && found(id)) {
+      result = true;
+    }
+    else if (id == start || !prune(id)) {
+      for (PersonID child : store.children(id)) {
+        push(child);
+      }
+    }
+  }
+
+  finish();
+  return result;
+}
+
+template <typename Found, typename Prune>
+bool Traversal::searchUp(const PersonStore& store, PersonID start, Found found, Prune prune) {
+  prepare(store);
+  push(start);
+
+  bool result = false;
+  while (!m_stack.empty() && !result) {
+    PersonID id = m_stack.back();
+    m_stack.pop_back();
+    if (id != start && found(id)) {
+      result = true;
+    }
+    else if (id == start || !prune(id)) {
+      push(store.mother(id));
+      push(store.father(id));
+    }
+  }
+
+  finish();
+  return result;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+// Timing and sampling shared by the benchmarks.
+//
+// Samples are drawn with between() rather than the library's distributions,
+// as bench/pedigree.h does, so a bench picks the same people on every
+// standard library.
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+typedef std::chrono::steady_clock Clock;
+
+// Microseconds since start.
+inline double elapsed(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// A number in [low, high], without the modulo bias of rng() % n.
+template <typename Int>
+Int between(std::mt19937& rng, Int low, Int high) {
+  uint64_t count = static_cast<uint64_t>(high - low) + 1;
+  return low + static_cast<Int>((static_cast<uint64_t>(rng()) * count) >> 32);
+}
+
+#endif
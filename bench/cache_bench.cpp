@@ -0,0 +1,153 @@
+// Benchmark: repeat queries with and without the relationship cache.
+//
+// Traffic is skewed, as it is in practice: most queries ask about a few
+// hundred popular people, the rest about anyone. Edits are interleaved
+// with the queries, mostly near the popular people, and every cached
+// answer is checked against a pool without a cache that gets the same
+// edits, so an answer the invalidation missed would show up.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./cache_bench [people] [generations] [queries] [hot] [edit every] [megabytes]
+
+#include "ChangeLog.h"
+#include "Parsing.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* const RELATIONSHIPS[] = {
+  "'s parents", "'s children", "'s siblings", "'s cousins", "'s grandparents",
+  "'s maternal aunts", "'s nephews", "'s full brothers", "'s ancestors", "'s descendants",
+};
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int queries     = argc > 3 ? std::atoi(argv[3]) : 200000;
+  int hot         = argc > 4 ? std::atoi(argv[4]) : 300;
+  int every       = argc > 5 ? std::atoi(argv[5]) : 100;
+  size_t budget   = (argc > 6 ? std::atoi(argv[6]) : 64) * size_t(1 << 20);
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, 2)).tsv();
+  GenePool cached(text.data(), text.size());
+  GenePool plain(text.data(), text.size());
+  cached.enableCache(budget);
+  people = static_cast<int>(plain.store().size());
+  std::mt19937 rng(12345);
+
+  // The popular people are in the younger half, where edits land too:
+  int per_generation = std::max(2, people / generations);
+  std::vector<int> popular;
+  for(int i = 0; i < hot; ++i) {
+    popular.push_back(between(rng, people / 2, people - 1));
+  }
+
+  // 90% of queries about the popular people, 10% about anyone:
+  std::vector<std::string> lines;
+  size_t relationships = sizeof(RELATIONSHIPS) / sizeof(RELATIONSHIPS[0]);
+  for(int q = 0; q < queries; ++q) {
+    int who = between(rng, 0, 99) < 90 ? popular[rng() % popular.size()] : int(rng() % people);
+    lines.push_back("P" + std::to_string(who) + RELATIONSHIPS[between(rng, size_t(0), relationships - 1)]);
+  }
+
+  // New people and new parents near the popular people. Parents come from
+  // an earlier generation than the child, so no edit makes a cycle.
+  std::vector<std::string> edits;
+  int added = 0;
+  auto nearest = [&](int id, Gender gender) {
+    // The closest person of gender at or below id, so never a later generation:
+    for(int i = id; i >= 0; --i) {
+      if(plain.store().gender(i) == gender) return "P" + std::to_string(i);
+    }
+    return std::string("???");
+  };
+  for(int q = every; q <= queries; q += every) {
+    int child = popular[rng() % popular.size()];
+    int generation = child / per_generation;
+    int above = between(rng, std::max(0, generation - 2) * per_generation, generation * per_generation - 1);
+    if(between(rng, 0, 99) < 50) {
+      edits.push_back("add\tN" + std::to_string(added++) + "\tfemale\t" + nearest(child, Gender::FEMALE) + '\t' + nearest(child, Gender::MALE) + "\n");
+    }
+    else {
+      edits.push_back("parents\tP" + std::to_string(child) + '\t' + nearest(above, Gender::FEMALE) + '\t' + nearest(above, Gender::MALE) + "\n");
+    }
+  }
+
+  // Parse once, so both runs time only the answers:
+  std::vector<Query> parsed;
+  for(const std::string& line: lines) parsed.emplace_back(line);
+
+  auto apply = [](GenePool& pool, const std::string& line, double& took) {
+    size_t used = 0;
+    size_t count = 0;
+    Clock::time_point start = Clock::now();
+    ChangeLog::apply(pool, line.data(), line.size(), used, count);
+    took += elapsed(start);
+  };
+
+  // Without the cache:
+  double plainTime = 0;
+  double plainEdits = 0;
+  std::vector<std::vector<PersonID>> expected(lines.size());
+  for(int q = 0; q < queries; ++q) {
+    if(q > 0 && q % every == 0) apply(plain, edits[q / every - 1], plainEdits);
+    Clock::time_point start = Clock::now();
+    PersonSet result = parsed[q].run(plain);
+    plainTime += elapsed(start);
+    result.ids(expected[q]);
+  }
+
+  // With it, checking every answer:
+  double cachedTime = 0;
+  double cachedEdits = 0;
+  size_t wrong = 0;
+  std::vector<PersonID> ids;
+  for(int q = 0; q < queries; ++q) {
+    if(q > 0 && q % every == 0) apply(cached, edits[q / every - 1], cachedEdits);
+    Clock::time_point start = Clock::now();
+    PersonSet result = parsed[q].run(cached);
+    cachedTime += elapsed(start);
+    ids.clear();
+    result.ids(ids);
+    if(ids != expected[q] && wrong++ < 5) {
+      std::cerr << "Stale answer to " << lines[q] << " (query " << q << ")\n";
+    }
+  }
+
+  // Steady state: the same popular queries again with no edits in between.
+  std::vector<int> repeats;
+  for(int q = 0; q < queries; ++q) {
+    if(lines[q].find("'s ancestors") == std::string::npos && lines[q].find("'s descendants") == std::string::npos) repeats.push_back(q);
+  }
+  Clock::time_point start = Clock::now();
+  size_t total = 0;
+  for(int q: repeats) total += parsed[q].run(cached).size();
+  double warm = elapsed(start);
+
+  RelationshipCache::Stats stats = cached.cache()->stats();
+  std::cout << "people:        " << people << " in " << generations << " generations, "
+            << hot << " popular, an edit every " << every << " queries\n";
+  std::cout << "no cache:      " << plainTime * 1000 / queries << " ns/query\n";
+  std::cout << "cache:         " << cachedTime * 1000 / queries << " ns/query, "
+            << stats.hitRate() * 100 << "% hits, " << stats.invalidations << " answers invalidated, "
+            << stats.evictions << " evicted\n";
+  std::cout << "warm repeats:  " << warm * 1000 / std::max<size_t>(repeats.size(), 1) << " ns/query ("
+            << total << " people found)\n";
+  std::cout << "edits:         " << plainEdits / std::max<size_t>(edits.size(), 1) << " us without the cache, "
+            << cachedEdits / std::max<size_t>(edits.size(), 1) << " us with it\n";
+  std::cout << "cache size:    " << stats.entries << " answers in " << stats.bytes / (1024.0 * 1024.0) << " MB\n";
+
+  if(wrong != 0) {
+    std::cerr << wrong << " stale answers!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Benchmark: ancestry checks through Person::ancestors() versus the closure index.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./closure_bench [people] [generations] [queries] [spread]
+
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int queries     = argc > 3 ? std::atoi(argv[3]) : 2000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+
+  std::mt19937 rng(12345);
+  std::vector<std::pair<Person*, Person*>> pairs;
+  for(int i = 0; i < queries; ++i) {
+    Person* a = pool.find("P" + std::to_string(between(rng, 0, people - 1)));
+    Person* b = pool.find("P" + std::to_string(people - 1 - between(rng, 0, people - 1) / 8));
+    pairs.emplace_back(a, b);
+  }
+
+  // Current path: materialize ancestors() and probe the set.
+  size_t hits = 0;
+  size_t total = 0;
+  Clock::time_point start = Clock::now();
+  for(auto& pair: pairs) {
+    PersonSet ancestors = pair.second->ancestors();
+    total += ancestors.size();
+    hits  += ancestors.count(pair.first);
+  }
+  double walk = elapsed(start);
+
+  start = Clock::now();
+  pool.buildClosureIndex();
+  double build = elapsed(start);
+
+  size_t index_hits = 0;
+  start = Clock::now();
+  for(int round = 0; round < 100; ++round) {
+    for(auto& pair: pairs) {
+      index_hits += pool.isAncestor(pair.first, pair.second);
+    }
+  }
+  double probe = elapsed(start) / 100;
+
+  size_t index_total = 0;
+  start = Clock::now();
+  for(auto& pair: pairs) {
+    index_total += pair.second->ancestors().size();
+  }
+  double enumerate = elapsed(start);
+
+  if(index_hits != hits * 100 || index_total != total) {
+    std::cerr << "Mismatch between ancestors() and the closure index!\n";
+    return 1;
+  }
+
+  std::cout << "people:                 " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "index build:            " << build / 1000 << " ms, "
+            << pool.closure()->intervals() << " intervals, "
+            << pool.closure()->bytes() / (1024.0 * 1024.0) << " MiB, "
+            << pool.closure()->coverage() * 100 << "% labeled\n";
+  std::cout << "avg ancestors per query:" << ' ' << double(total) / queries << "\n";
+  std::cout << "is-ancestor via set:    " << walk / queries << " us/query\n";
+  std::cout << "is-ancestor via index:  " << probe * 1000 / queries << " ns/query\n";
+  std::cout << "ancestors() with index: " << enumerate / queries << " us/query\n";
+  return 0;
+}
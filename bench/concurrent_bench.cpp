@@ -0,0 +1,141 @@
+// Benchmark: queries from many threads while one thread streams in edits.
+//
+// Readers ask for the children and parents of people in the youngest
+// generations, and check that each answer agrees with itself: every child
+// lists the person as a parent and every parent lists them as a child. The
+// writer meanwhile adds people with parents among those same people, moves
+// them to other parents and removes some, in batches, so a reader that saw
+// half an update would notice.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./concurrent_bench [people] [generations] [readers] [batch] [seconds]
+
+#include "ConcurrentPool.h"
+#include "Parsing.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Tally {
+  size_t reads = 0;
+  size_t torn = 0;
+};
+
+// One reader: query random people until told to stop.
+static void reader(const ConcurrentPool& shared, int first, int last, unsigned seed, const std::atomic<bool>& stop, Tally& tally) {
+  std::mt19937 rng(seed);
+
+  while(!stop.load(std::memory_order_relaxed)) {
+    std::string name = "P" + std::to_string(between(rng, first, last - 1));
+    ConcurrentPool::Reader read = shared.read();
+    const GenePool& pool = *read;
+
+    Person* person = pool.find(name);
+    PersonSet children = Query(name + "'s children").run(pool);
+    PersonSet parents = Query(name + "'s parents").run(pool);
+    for(Person* child: children) {
+      if(child->mother() != person && child->father() != person) ++tally.torn;
+    }
+    for(Person* parent: parents) {
+      const PersonStore& store = pool.store();
+      IDRange family = store.children(parent->id());
+      if(std::find(family.begin(), family.end(), person->id()) == family.end()) ++tally.torn;
+    }
+    ++tally.reads;
+  }
+}
+
+// Run the readers (and maybe the writer) for a while; returns reads per second.
+static double run(ConcurrentPool& shared, int readers, int first, int last, int batch, double seconds, bool write, Tally& total, size_t& updates, double& worst) {
+  std::atomic<bool> stop(false);
+  std::vector<Tally> tallies(readers);
+  std::vector<std::thread> threads;
+  for(int r = 0; r < readers; ++r) {
+    threads.emplace_back(reader, std::cref(shared), first, last, 1000u + r, std::cref(stop), std::ref(tallies[r]));
+  }
+
+  // The writer adds W people, moves each to other parents straight away and
+  // removes them again a thousand people later:
+  std::mt19937 rng(7);
+  Clock::time_point start = Clock::now();
+  static int added = 0;
+  updates = 0;
+  worst = 0;
+  while(elapsed(start) < seconds * 1e6) {
+    if(!write) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    std::string lines;
+    for(int k = 0; k < batch; k += 3) {
+      auto mother = [&]() { return "P" + std::to_string(between(rng, first, last - 1)); };
+      auto father = [&]() { return "P" + std::to_string(between(rng, first, last - 1)); };
+      std::string name = "W" + std::to_string(added++);
+      lines += "add\t" + name + "\tmale\t" + mother() + '\t' + father() + '\n';
+      lines += "parents\t" + name + '\t' + mother() + '\t' + father() + '\n';
+      if(added > 1000) lines += "remove\tW" + std::to_string(added - 1000) + '\n';
+    }
+
+    Clock::time_point begin = Clock::now();
+    shared.update(lines);
+    worst = std::max(worst, elapsed(begin));
+    ++updates;
+  }
+
+  stop.store(true);
+  for(std::thread& thread: threads) thread.join();
+  double took = elapsed(start) / 1e6;
+
+  total = Tally();
+  for(const Tally& tally: tallies) {
+    total.reads += tally.reads;
+    total.torn += tally.torn;
+  }
+  return total.reads / took;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int readers     = argc > 3 ? std::atoi(argv[3]) : std::max(2u, workerCount() - 1);
+  int batch       = argc > 4 ? std::atoi(argv[4]) : 30;
+  double seconds  = argc > 5 ? std::atof(argv[5]) : 2.0;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, 2)).tsv();
+  ConcurrentPool shared(text.data(), text.size());
+  people = static_cast<int>(shared.read()->store().size());
+
+  // The last two generations: parents of the writer's new people, and their children
+  int per_generation = std::max(2, people / generations);
+  int first = std::max(0, people - 2 * per_generation);
+
+  Tally quiet;
+  Tally busy;
+  size_t updates = 0;
+  double worst = 0;
+  double alone = run(shared, readers, first, people, batch, seconds, false, quiet, updates, worst);
+  double mixed = run(shared, readers, first, people, batch, seconds, true, busy, updates, worst);
+
+  std::cout << "people:        " << people << " in " << generations << " generations\n";
+  std::cout << "reads only:    " << alone << " reads/s on " << readers << " threads\n";
+  std::cout << "with writes:   " << mixed << " reads/s, " << updates / seconds << " updates/s of "
+            << batch << " edits (" << updates * batch / seconds << " edits/s, slowest update "
+            << worst / 1000 << " ms)\n";
+
+  if(quiet.torn + busy.torn != 0) {
+    std::cerr << quiet.torn + busy.torn << " inconsistent answers!\n";
+    return 1;
+  }
+  return 0;
+}
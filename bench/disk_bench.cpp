@@ -0,0 +1,147 @@
+// Benchmark: queries on a snapshot that starts out on disk, not in memory.
+//
+// The pedigree's rows are shuffled, as real data files come in no useful
+// order, and loaded with ANY_ORDER. The pool is saved as a snapshot twice,
+// as loaded and in FAMILIES order, and dropped. Then, for each snapshot,
+// its pages are evicted from the page cache, it is opened, and a sample of
+// queries is run cold and then warm. mincore() tells how much of the file
+// opening and the queries pulled into memory. Opening reads the link
+// columns once to check them, but only the pages queries touch need to
+// stay; that, and not the size of the pool, is what a pool larger than RAM
+// needs to hold. The heap is reported on open and after the queries; it
+// grows only by the pages of Person views the queries make.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./disk_bench [--people N] [--generations N] [--seed N] [--queries N] [--dir path]
+
+#include "Parsing.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Drop a file's pages from the page cache, writing them out first (dirty
+// pages are not dropped).
+static void evict(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) return;
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// Bytes of a mapping that are in memory.
+static size_t resident(const MappedFile& file) {
+  size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  std::vector<unsigned char> pages((file.size() + page - 1) / page);
+  if(::mincore(const_cast<char*>(file.data()), file.size(), pages.data()) != 0) return 0;
+  size_t count = 0;
+  for(unsigned char flags: pages) count += flags & 1;
+  return count * page;
+}
+
+static const char* const RELATIONSHIPS[] = {
+  "'s parents", "'s children", "'s siblings", "'s cousins", "'s grandparents",
+  "'s maternal aunts", "'s nephews", "'s full brothers", "'s grandchildren", "'s uncles",
+};
+
+int main(int argc, char** argv) {
+  PedigreeOptions options;
+  options.people = 2000000;
+  int queries = 2000;
+  std::string dir = ".";
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if(value == nullptr) {
+      std::cerr << "Missing value for " << arg << "\n";
+      return 1;
+    }
+    ++i;
+    if(arg == "--people") options.people = std::atoi(value);
+    else if(arg == "--generations") options.generations = std::atoi(value);
+    else if(arg == "--seed") options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if(arg == "--queries") queries = std::atoi(value);
+    else if(arg == "--dir") dir = value;
+    else {
+      std::cerr << "Unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  // Shuffled rows, loaded and saved both ways:
+  std::string paths[2] = {dir + "/disk_bench_loaded.bin", dir + "/disk_bench_families.bin"};
+  size_t people = 0;
+  {
+    std::string text = PedigreeGenerator(options).tsv();
+    std::vector<std::string> rows;
+    for(size_t start = 0, end; start < text.size(); start = end + 1) {
+      end = text.find('\n', start);
+      rows.push_back(text.substr(start, end + 1 - start));
+    }
+    std::mt19937 rng(options.seed);
+    std::shuffle(rows.begin(), rows.end(), rng);
+    text.clear();
+    for(const std::string& row: rows) text += row;
+
+    GenePool pool(text.data(), text.size(), LoadMode::ANY_ORDER);
+    people = pool.store().size();
+    pool.save(paths[0].c_str(), PersonOrder::LOADED);
+    pool.save(paths[1].c_str(), PersonOrder::FAMILIES);
+  }
+
+  std::mt19937 rng(options.seed + 1);
+  std::vector<std::string> lines;
+  for(int q = 0; q < queries; ++q) {
+    lines.push_back("P" + std::to_string(rng() % people) + RELATIONSHIPS[rng() % (sizeof(RELATIONSHIPS) / sizeof(RELATIONSHIPS[0]))]);
+  }
+  std::vector<Query> parsed;
+  for(const std::string& line: lines) parsed.emplace_back(line);
+
+  std::cout << "people:   " << people << ", " << queries << " queries\n";
+  size_t answers[2] = {0, 0};
+  for(int order = 0; order < 2; ++order) {
+    evict(paths[order]);
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(paths[order].c_str(), Access::RANDOM);
+    GenePool pool(file);
+    size_t opened = resident(*file);
+    size_t heap = pool.memoryUsage().total();
+
+    Clock::time_point start = Clock::now();
+    for(const Query& query: parsed) answers[order] += query.run(pool).size();
+    double cold = elapsed(start);
+    size_t touched = resident(*file);
+
+    start = Clock::now();
+    for(const Query& query: parsed) query.run(pool);
+    double warm = elapsed(start);
+
+    double megabyte = 1024.0 * 1024.0;
+    std::cout << (order == 0 ? "loaded:   " : "families: ") << file->size() / megabyte << " MB file, "
+              << opened / megabyte << " MB read to open, " << touched / megabyte << " MB after the queries ("
+              << touched * 100.0 / file->size() << "%), " << cold / queries << " us/query cold, "
+              << warm / queries << " us/query warm, " << heap / megabyte << " MB heap on open, "
+              << pool.memoryUsage().total() / megabyte << " MB after\n";
+  }
+
+  std::remove(paths[0].c_str());
+  std::remove(paths[1].c_str());
+  if(answers[0] != answers[1]) {
+    std::cerr << "The two orders gave different answers!\n";
+    return 1;
+  }
+  return 0;
+}
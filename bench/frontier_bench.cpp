@@ -0,0 +1,79 @@
+// Benchmark: one relationship for everyone, person by person versus GenePool::expand().
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./frontier_bench [people] [generations] [spread]
+
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int spread      = argc > 3 ? std::atoi(argv[3]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+
+  std::vector<PersonID> everyone(pool.store().size());
+  for(size_t i = 0; i < everyone.size(); ++i) {
+    everyone[i] = static_cast<PersonID>(i);
+  }
+
+  struct Report {
+    const char*  label;
+    Relationship relationship;
+    PMod         pmod;
+    SMod         smod;
+    std::function<PersonSet(Person*)> ask;
+  };
+
+  std::vector<Report> reports = {
+    {"grandchildren:        ", Relationship::GRANDCHILDREN, PMod::ANY, SMod::ANY, [](Person* p) { return p->grandchildren(); }},
+    {"siblings:             ", Relationship::SIBLINGS, PMod::ANY, SMod::ANY, [](Person* p) { return p->siblings(); }},
+    {"half sisters:         ", Relationship::SISTERS, PMod::ANY, SMod::HALF, [](Person* p) { return p->sisters(PMod::ANY, SMod::HALF); }},
+    {"maternal full aunts:  ", Relationship::AUNTS, PMod::MATERNAL, SMod::FULL, [](Person* p) { return p->aunts(PMod::MATERNAL, SMod::FULL); }},
+    {"cousins:              ", Relationship::COUSINS, PMod::ANY, SMod::ANY, [](Person* p) { return p->cousins(); }},
+    {"nieces:               ", Relationship::NIECES, PMod::ANY, SMod::ANY, [](Person* p) { return p->nieces(); }},
+  };
+
+  std::cout << "people:               " << people << " in " << generations << " generations, spread " << spread << "\n";
+  for(const Report& report: reports) {
+    // Warm up both ways (and the expander's buffers) first:
+    pool.expand(everyone.data(), everyone.data() + everyone.size(), report.relationship, report.pmod, report.smod);
+    for(PersonID id: everyone) {
+      report.ask(pool.person(id));
+    }
+
+    size_t total = 0;
+    Clock::time_point start = Clock::now();
+    for(PersonID id: everyone) {
+      total += report.ask(pool.person(id)).size();
+    }
+    double each = elapsed(start) / 1000;
+
+    start = Clock::now();
+    Expansion bulk = pool.expand(everyone.data(), everyone.data() + everyone.size(), report.relationship, report.pmod, report.smod);
+    double once = elapsed(start) / 1000;
+
+    if(bulk.ids.size() != total) {
+      std::cerr << "Mismatch between expand() and the relationship functions!\n";
+      return 1;
+    }
+
+    std::cout << report.label << once << " ms in bulk vs " << each << " ms person by person ("
+              << double(total) / people << " per person)\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+// Benchmark: GenePool::relationship() versus searching all ancestors.
+//
+// The exhaustive version finds every ancestor of both people with their
+// distances, then picks the closest common ones by the same rules. Each
+// pair's answers are checked against each other.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./kinship_bench [people] [generations] [pairs] [spread]
+
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Every ancestor of start (and start), with their distance and which of
+// start's parents leads to them (1 maternal, 2 paternal, 3 both).
+struct Line {
+  uint32_t distance;
+  uint8_t  branch;
+};
+
+static std::unordered_map<PersonID, Line> lines(const PersonStore& store, PersonID start) {
+  std::unordered_map<PersonID, Line> result;
+  result[start] = Line{0, 0};
+  std::vector<PersonID> frontier(1, start);
+  for(uint32_t level = 1; !frontier.empty(); ++level) {
+    std::vector<PersonID> next;
+    for(PersonID id: frontier) {
+      PersonID parents[2] = {store.mother(id), store.father(id)};
+      for(int k = 0; k < 2; ++k) {
+        if(parents[k] == NO_PERSON) continue;
+        uint8_t branch = level == 1 ? uint8_t(k + 1) : result[id].branch;
+        auto found = result.find(parents[k]);
+        if(found == result.end()) {
+          result[parents[k]] = Line{level, branch};
+          next.push_back(parents[k]);
+        }
+        else if(found->second.distance == level) {
+          found->second.branch |= branch;
+        }
+      }
+    }
+    frontier.swap(next);
+  }
+  return result;
+}
+
+static Kinship exhaustive(const PersonStore& store, PersonID a, PersonID b) {
+  Kinship result;
+  if(a == b) {
+    result.ancestor = a;
+    return result;
+  }
+
+  std::unordered_map<PersonID, Line> mine = lines(store, a);
+  std::unordered_map<PersonID, Line> theirs = lines(store, b);
+  uint32_t best = UINT32_MAX;
+  for(auto& entry: mine) {
+    auto other = theirs.find(entry.first);
+    if(other != theirs.end()) best = std::min(best, entry.second.distance + other->second.distance);
+  }
+  if(best == UINT32_MAX) return result;
+
+  uint32_t up = UINT32_MAX;
+  for(auto& entry: mine) {
+    auto other = theirs.find(entry.first);
+    if(other == theirs.end() || entry.second.distance + other->second.distance != best) continue;
+    uint32_t candidate = entry.second.distance;
+    uint32_t reach = std::max(candidate, best - candidate);
+    if(up == UINT32_MAX || reach < std::max(up, best - up) || (reach == std::max(up, best - up) && candidate < up)) {
+      up = candidate;
+    }
+  }
+
+  uint32_t shared = 0;
+  uint8_t branch = 0;
+  for(auto& entry: mine) {
+    auto other = theirs.find(entry.first);
+    if(other == theirs.end() || entry.second.distance != up || other->second.distance != best - up) continue;
+    shared += 1;
+    branch |= entry.second.branch;
+    result.ancestor = std::min(result.ancestor, entry.first);
+  }
+
+  result.up = up;
+  result.down = best - up;
+  if(result.up > 1 || (result.up == 1 && result.down > 0)) {
+    result.side = branch == 1 ? PMod::MATERNAL : branch == 2 ? PMod::PATERNAL : PMod::ANY;
+  }
+  if(result.up > 0 && result.down > 0) {
+    result.smod = shared > 1 ? SMod::FULL : SMod::HALF;
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int pairs       = argc > 3 ? std::atoi(argv[3]) : 20000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+  const PersonStore& store = pool.store();
+
+  // Pairs a few generations and a few couples apart, who are usually kin:
+  int per_generation = std::max(2, people / generations);
+  std::mt19937 rng(12345);
+  std::vector<std::pair<Person*, Person*>> work;
+  for(int i = 0; i < pairs; ++i) {
+    int a = between(rng, 0, people - 1);
+    int apart = between(rng, -3, 3) * per_generation + between(rng, -4 * spread - 4, 4 * spread + 4);
+    int b = std::min(people - 1, std::max(0, a + apart));
+    work.emplace_back(pool.person(a), pool.person(b));
+  }
+
+  // The first call works out generations; keep it out of the timing.
+  Clock::time_point start = Clock::now();
+  pool.relationship(work[0].first, work[0].second);
+  double setup = elapsed(start);
+
+  std::vector<Kinship> fast;
+  start = Clock::now();
+  for(auto& pair: work) {
+    fast.push_back(pool.relationship(pair.first, pair.second));
+  }
+  double solved = elapsed(start);
+
+  size_t related = 0;
+  size_t mismatches = 0;
+  start = Clock::now();
+  for(size_t i = 0; i < work.size(); ++i) {
+    Kinship slow = exhaustive(store, work[i].first->id(), work[i].second->id());
+    related += slow.related();
+    Gender gender = work[i].second->gender();
+    if(to_string(slow, gender) != to_string(fast[i], gender) || slow.ancestor != fast[i].ancestor) {
+      if(mismatches++ < 5) {
+        std::cerr << work[i].first->name() << " / " << work[i].second->name() << ": "
+                  << to_string(fast[i], gender) << " vs " << to_string(slow, gender) << "\n";
+      }
+    }
+  }
+  double searched = elapsed(start);
+
+  std::cout << "people:        " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "generations:   " << setup / 1000 << " ms, once\n";
+  std::cout << "relationship:  " << solved / pairs << " us/pair vs " << searched / pairs << " us/pair searching all ancestors ("
+            << 100.0 * related / pairs << "% related, " << 3.6e9 / solved * pairs / 1e6 << " million pairs/hour on one core)\n";
+
+  if(mismatches != 0) {
+    std::cerr << mismatches << " mismatches between relationship() and the exhaustive search!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Benchmark: commonAncestor() along parent lines, walking versus the LCA index.
+//
+// Also saves the pool with its index as a snapshot, reopens it and checks
+// the mapped index gives the same answers.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./lca_bench [people] [generations] [queries] [spread]
+
+#include "family.h"
+#include "Snapshot.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Answer every pair on both lines; returns the answers' IDs.
+static std::vector<PersonID> ask(const GenePool& pool, const std::vector<std::pair<PersonID, PersonID>>& pairs) {
+  std::vector<PersonID> result;
+  for(auto& pair: pairs) {
+    for(PMod line: {PMod::MATERNAL, PMod::PATERNAL}) {
+      Person* found = pool.commonAncestor(pool.person(pair.first), pool.person(pair.second), line);
+      result.push_back(found ? found->id() : NO_PERSON);
+    }
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 1000;
+  int queries     = argc > 3 ? std::atoi(argv[3]) : 20000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+
+  std::mt19937 rng(12345);
+  std::vector<std::pair<PersonID, PersonID>> pairs;
+  for(int i = 0; i < queries; ++i) {
+    PersonID a = between(rng, 0, people - 1);
+    pairs.emplace_back(a, between(rng, 0, people - 1));
+  }
+
+  Clock::time_point start = Clock::now();
+  std::vector<PersonID> walked = ask(pool, pairs);
+  double walk = elapsed(start);
+
+  start = Clock::now();
+  pool.buildLCAIndex();
+  double build = elapsed(start);
+
+  start = Clock::now();
+  std::vector<PersonID> indexed = ask(pool, pairs);
+  double lift = elapsed(start);
+
+  const char* path = "lca_bench.snapshot";
+  pool.save(path);
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+  GenePool reopened(file, true);
+  std::vector<PersonID> mapped = ask(reopened, pairs);
+  bool carried = reopened.lca() != nullptr;
+  std::remove(path);
+
+  size_t found = std::count_if(walked.begin(), walked.end(), [](PersonID id) { return id != NO_PERSON; });
+  std::cout << "people:           " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "index build:      " << build / 1000 << " ms, " << pool.lca()->bytes() / (1024.0 * 1024.0) << " MiB\n";
+  std::cout << "walking lines:    " << walk / walked.size() << " us/query\n";
+  std::cout << "LCA index:        " << lift * 1000 / indexed.size() << " ns/query ("
+            << 100.0 * found / walked.size() << "% of lines meet)\n";
+
+  if(walked != indexed || !carried || mapped != indexed) {
+    std::cerr << "Mismatch between walking, the LCA index and its snapshot!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,215 @@
+// Benchmark: what a pool costs to keep, per person.
+//
+// Every heap allocation in the process goes through a counting operator
+// new, so the bench can check GenePool::memoryUsage() against the bytes
+// the pool really holds, and measure the same pedigree in the layout the
+// pool started out with (a std::map from std::string names to Person
+// objects, each with a std::set of children). Both are reported before and
+// after compact(), with the indexes built, and with edits made, along with
+// how many allocations loading takes and how long each layout takes to
+// free.
+//
+// Measurements take in the scratch buffers threads keep for traversals,
+// which memoryUsage() leaves out as they belong to no pool.
+//
+// The run fails if the compacted pool is not at least --target times
+// smaller than the map layout, or if memoryUsage() is more than 10% off.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./memory_bench [--people N] [--generations N] [--seed N] [--edits N] [--target F]
+
+#include "ChangeLog.h"
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+// Live heap bytes, as asked for (malloc's own overhead is not included).
+// Each block carries its size in a header in front of it.
+static std::atomic<size_t> live{0};
+static std::atomic<size_t> allocations{0};
+
+static void* allocate(size_t size, size_t align) {
+  size_t header = std::max(align, alignof(std::max_align_t));
+  size_t total = (size + header + align - 1) / align * align;
+  char* block = static_cast<char*>(std::aligned_alloc(align, total));
+  if(block == nullptr) throw std::bad_alloc();
+  char* user = block + header;
+  reinterpret_cast<size_t*>(user)[-1] = size;
+  reinterpret_cast<size_t*>(user)[-2] = header;
+  live.fetch_add(size, std::memory_order_relaxed);
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return user;
+}
+
+static void release(void* pointer) {
+  if(pointer == nullptr) return;
+  char* user = static_cast<char*>(pointer);
+  live.fetch_sub(reinterpret_cast<size_t*>(user)[-1], std::memory_order_relaxed);
+  std::free(user - reinterpret_cast<size_t*>(user)[-2]);
+}
+
+void* operator new(size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t align) { return allocate(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return allocate(size, static_cast<size_t>(align)); }
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+
+// The original layout, loaded the way it loaded data files.
+struct MapPerson {
+  std::string         name;
+  Gender              gender;
+  MapPerson*          mother;
+  MapPerson*          father;
+  std::set<MapPerson*> children;
+};
+
+static size_t mapLayout(const std::string& text, size_t& calls, double& teardown) {
+  size_t before = live.load();
+  size_t counted = allocations.load();
+  std::map<std::string, MapPerson*> people;
+  size_t start = 0;
+  while(start < text.size()) {
+    size_t end = text.find('\n', start);
+    std::string fields[4];
+    size_t field = 0;
+    for(size_t i = start; i < end; ++i) {
+      if(text[i] == '\t') ++field;
+      else fields[field] += text[i];
+    }
+    start = end + 1;
+
+    MapPerson* mother = fields[2] == "???" ? nullptr : people[fields[2]];
+    MapPerson* father = fields[3] == "???" ? nullptr : people[fields[3]];
+    MapPerson* person = new MapPerson{fields[0], fields[1] == "male" ? Gender::MALE : Gender::FEMALE, mother, father, {}};
+    people[fields[0]] = person;
+    if(mother) mother->children.insert(person);
+    if(father) father->children.insert(person);
+  }
+
+  size_t bytes = live.load() - before;
+  calls = allocations.load() - counted;
+  Clock::time_point freeing = Clock::now();
+  for(auto& entry: people) delete entry.second;
+  people.clear();
+  teardown = elapsed(freeing);
+  return bytes;
+}
+
+static void report(const char* label, const GenePool& pool, size_t measured, double& worst) {
+  MemoryUsage usage = pool.memoryUsage();
+  double people = static_cast<double>(std::max<size_t>(pool.store().size(), 1));
+  double error = measured ? (double(usage.total()) - double(measured)) / double(measured) : 0;
+  worst = std::max(worst, std::abs(error));
+
+  std::cout << label << usage.total() / people << " bytes/person (" << measured / people << " measured, "
+            << (error >= 0 ? "+" : "") << error * 100 << "%): "
+            << usage.names / people << " names, " << usage.links / people << " links, "
+            << usage.adjacency / people << " adjacency, " << usage.indexes / people << " indexes, "
+            << usage.caches / people << " caches\n";
+}
+
+int main(int argc, char** argv) {
+  PedigreeOptions options;
+  int edits = 20000;
+  double target = 3;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if(value == nullptr) {
+      std::cerr << "Missing value for " << arg << "\n";
+      return 1;
+    }
+    ++i;
+    if(arg == "--people") options.people = std::atoi(value);
+    else if(arg == "--generations") options.generations = std::atoi(value);
+    else if(arg == "--seed") options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if(arg == "--edits") edits = std::atoi(value);
+    else if(arg == "--target") target = std::atof(value);
+    else {
+      std::cerr << "Unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  std::string text = PedigreeGenerator(options).tsv();
+  size_t mapCalls = 0;
+  double mapTeardown = 0;
+  size_t map = mapLayout(text, mapCalls, mapTeardown);
+
+  // Loading, with every Person view made:
+  size_t before = live.load();
+  size_t counted = allocations.load();
+  GenePool* pool = new GenePool(text.data(), text.size());
+  for(PersonID id = 0; id < pool->store().size(); ++id) pool->person(id);
+  size_t poolCalls = allocations.load() - counted;
+  double worst = 0;
+  report("loaded:      ", *pool, live.load() - before, worst);
+
+  pool->compact();
+  size_t compact = live.load() - before;
+  report("compact:     ", *pool, compact, worst);
+
+  pool->buildClosureIndex();
+  pool->buildLCAIndex();
+  pool->generations();
+  report("indexed:     ", *pool, live.load() - before, worst);
+
+  // Edits grow the columns and move children lists, then compact() again:
+  size_t people = pool->store().size();
+  std::string changes;
+  for(int e = 0; e < edits; ++e) {
+    size_t parent = people / 4 + (e * 7919u) % (people / 2);
+    changes += "add\tE" + std::to_string(e) + "\tmale\tP" + std::to_string(parent | 1) + "\tP" + std::to_string(parent & ~size_t(1)) + "\n";
+  }
+  size_t used = 0;
+  size_t count = 0;
+  ChangeLog::apply(*pool, changes.data(), changes.size(), used, count);
+  report("edited:      ", *pool, live.load() - before, worst);
+  pool->compact();
+  report("recompacted: ", *pool, live.load() - before, worst);
+  Clock::time_point start = Clock::now();
+  delete pool;
+  double poolTeardown = elapsed(start);
+
+  // Scratch kept per thread by traversals and edits, which the pool does
+  // not own; it is most of the difference after edits.
+  std::cout << "scratch:     " << double(live.load() - before) / people << " bytes/person left after the pool\n";
+
+  double ratio = double(map) / double(std::max<size_t>(compact, 1));
+  std::cout << "map layout:  " << double(map) / people << " bytes/person, "
+            << ratio << "x the compacted pool (target " << target << "x)\n";
+  std::cout << "allocations: " << poolCalls << " to load the pool, " << mapCalls << " the map layout\n";
+  std::cout << "teardown:    " << poolTeardown / 1000 << " ms for the pool, " << mapTeardown / 1000 << " ms the map layout\n";
+
+  int status = 0;
+  if(ratio < target) {
+    std::cerr << "The compacted pool misses the target.\n";
+    status = 1;
+  }
+  if(worst > 0.10) {
+    std::cerr << "memoryUsage() is off by " << worst * 100 << "%.\n";
+    status = 1;
+  }
+  return status;
+}
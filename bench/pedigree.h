@@ -0,0 +1,186 @@
+#ifndef BENCH_PEDIGREE_H
+#define BENCH_PEDIGREE_H
+
+// A synthetic pedigree for benchmarks, as an IN_ORDER data file.
+//
+// People come in generations of about people / generations each, named P0,
+// P1, ... in order, so parents always come before their children. Each
+// generation pairs up the one before it into couples, a couple per
+// `fertility` children, and hands the children out to the couples in turn.
+// Partners are found near each other (within `spread` places of their
+// position in the generation), so families stay local, as they do in real
+// pedigrees, and ancestries widen slowly instead of covering everyone a
+// few generations up.
+//
+// On top of that:
+//   halfSiblings  a child's father is another man nearby
+//   remarriage    a couple shares the mother or father of the couple before
+//   collapse      a couple are first cousins, when the mother has any
+//
+// The output only depends on the options: the generator draws raw numbers
+// from std::mt19937 (whose sequence the standard fixes) rather than using
+// the library's distributions, which differ between implementations.
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+struct PedigreeOptions {
+  int      people       = 200000;  // About this many, founders included
+  int      generations  = 40;
+  double   fertility    = 2.5;     // Children per couple, on average
+  int      spread       = 3;       // How far away partners may live
+  double   halfSiblings = 0.05;    // Chance a child has another father
+  double   remarriage   = 0.10;    // Chance a couple shares a partner with the last
+  double   collapse     = 0.02;    // Chance a couple are cousins
+  uint32_t seed         = 12345;
+};
+
+// The plain pedigree: two children a couple, partners within spread places
+// of each other, and none of the extras above.
+inline PedigreeOptions plainPedigree(int people, int generations, int spread) {
+  PedigreeOptions options;
+  options.people       = people;
+  options.generations  = generations;
+  options.fertility    = 2;
+  options.spread       = spread;
+  options.halfSiblings = 0;
+  options.remarriage   = 0;
+  options.collapse     = 0;
+  return options;
+}
+
+class PedigreeGenerator {
+  struct Row {
+    bool    male;
+    int32_t mother;
+    int32_t father;
+  };
+
+  PedigreeOptions  m_options;
+  std::mt19937     m_rng;
+  std::vector<Row> m_rows;
+
+  // [0, n), without the modulo bias of rng() % n
+  uint32_t below(uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(m_rng()) * n) >> 32);
+  }
+
+  bool chance(double p) {
+    return m_rng() < p * 4294967296.0;
+  }
+
+  // Someone in group (which is in ID order) near the ID target. Going by ID
+  // rather than by place in the group keeps partners close even where one
+  // gender outnumbers the other for a while.
+  int32_t near(const std::vector<int32_t>& group, int32_t target) {
+    int32_t size = static_cast<int32_t>(group.size());
+    int32_t spread = std::max(0, m_options.spread);
+    int32_t at = static_cast<int32_t>(std::lower_bound(group.begin(), group.end(), target) - group.begin());
+    at += static_cast<int32_t>(below(2 * spread + 1)) - spread;
+    return group[std::min(size - 1, std::max(0, at))];
+  }
+
+  // Up to four grandparents of id, -1 for unknown ones:
+  void grandparents(int32_t id, int32_t out[4]) const {
+    const Row& row = m_rows[id];
+    int n = 0;
+    for(int32_t parent: {row.mother, row.father}) {
+      out[n++] = parent < 0 ? -1 : m_rows[parent].mother;
+      out[n++] = parent < 0 ? -1 : m_rows[parent].father;
+    }
+  }
+
+  // A man of woman's generation, [first, last), who shares a grandparent
+  // but not a parent with her, or -1. Families are local, so only the
+  // people around her are looked at.
+  int32_t cousin(int32_t woman, int32_t first, int32_t last) {
+    int32_t window = static_cast<int32_t>(8 * (m_options.spread + 1) * std::max(1.0, m_options.fertility));
+    int32_t hers[4];
+    grandparents(woman, hers);
+
+    std::vector<int32_t> found;
+    for(int32_t id = std::max(first, woman - window); id < std::min(last, woman + window); ++id) {
+      const Row& row = m_rows[id];
+      if(!row.male || row.mother == m_rows[woman].mother || row.father == m_rows[woman].father) continue;
+      int32_t his[4];
+      grandparents(id, his);
+      bool shared = false;
+      for(int32_t a: hers) {
+        for(int32_t b: his) shared = shared || (a >= 0 && a == b);
+      }
+      if(shared) found.push_back(id);
+    }
+    return found.empty() ? -1 : found[below(static_cast<uint32_t>(found.size()))];
+  }
+
+  void generate() {
+    int generations = std::max(1, m_options.generations);
+    int per = std::max(2, m_options.people / generations);
+    m_rows.clear();
+    m_rng.seed(m_options.seed);
+
+    for(int i = 0; i < per; ++i) m_rows.push_back(Row{chance(0.5), -1, -1});
+
+    for(int g = 1; g < generations; ++g) {
+      int32_t first = static_cast<int32_t>((g - 1) * per);
+      int32_t last = first + per;
+      std::vector<int32_t> women;
+      std::vector<int32_t> men;
+      for(int32_t id = first; id < last; ++id) (m_rows[id].male ? men : women).push_back(id);
+      if(women.empty() || men.empty()) break;
+
+      // Couples, in position order, couple k living around place(k):
+      int couples = std::max(1, static_cast<int>(per / std::max(0.1, m_options.fertility) + 0.5));
+      auto place = [&](int k) { return first + static_cast<int32_t>((k + 0.5) * per / couples); };
+      std::vector<std::pair<int32_t, int32_t>> pairs;
+      for(int k = 0; k < couples; ++k) {
+        int32_t mother = near(women, place(k));
+        int32_t father = -1;
+        if(!pairs.empty() && chance(m_options.remarriage)) {
+          if(chance(0.5)) mother = pairs.back().first;
+          else father = pairs.back().second;
+        }
+        if(father < 0 && chance(m_options.collapse)) father = cousin(mother, first, last);
+        if(father < 0) father = near(men, place(k));
+        pairs.emplace_back(mother, father);
+      }
+
+      // Children, a couple's worth at a time with a little variation:
+      for(int i = 0; i < per; ++i) {
+        int k = static_cast<int>((static_cast<int64_t>(i) * couples) / per) + static_cast<int>(below(3)) - 1;
+        k = std::min(couples - 1, std::max(0, k));
+        int32_t father = pairs[k].second;
+        if(chance(m_options.halfSiblings)) father = near(men, place(k));
+        m_rows.push_back(Row{chance(0.5), pairs[k].first, father});
+      }
+    }
+  }
+
+public:
+  explicit PedigreeGenerator(const PedigreeOptions& options) : m_options(options), m_rng(options.seed) {}
+
+  // The data file, with genders and parents (??? for founders).
+  std::string tsv() {
+    generate();
+    std::string out;
+    out.reserve(m_rows.size() * 28);
+    auto name = [&](int32_t id) {
+      if(id < 0) out += "???";
+      else out += 'P' + std::to_string(id);
+    };
+    for(size_t i = 0; i < m_rows.size(); ++i) {
+      name(static_cast<int32_t>(i));
+      out += m_rows[i].male ? "\tmale\t" : "\tfemale\t";
+      name(m_rows[i].mother);
+      out += '\t';
+      name(m_rows[i].father);
+      out += '\n';
+    }
+    return out;
+  }
+};
+
+#endif
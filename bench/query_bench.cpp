@@ -0,0 +1,141 @@
+// Benchmark: chained and combined queries in one Query versus one hop at a time.
+//
+// The separate runs do what a REPL user would: ask for the first hop, then
+// ask for the next hop of every person in the answer, and combine the sets
+// by hand.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./query_bench [people] [generations] [queries] [spread]
+
+#include "Parsing.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Helpers for the one-hop-at-a-time versions:
+static std::vector<PersonID> ask(const GenePool& pool, const std::string& text) {
+  std::vector<PersonID> ids;
+  Query(text).run(pool).ids(ids);
+  return ids;
+}
+
+static std::vector<PersonID> hop(const GenePool& pool, const std::vector<PersonID>& people, const std::string& relationship) {
+  PersonSet result(&pool);
+  for(PersonID id: people) {
+    std::string name(pool.store().name(id));
+    result.merge(Query(name + "'s " + relationship).run(pool));
+  }
+  std::vector<PersonID> ids;
+  result.ids(ids);
+  return ids;
+}
+
+typedef std::function<std::vector<PersonID>(const std::string& a, const std::string& b)> Separate;
+
+// Time both ways of answering one kind of query over the same names:
+static bool compare(const GenePool& pool, const char* label, const std::string& pattern, Separate separate, const std::vector<std::pair<std::string, std::string>>& names) {
+  auto fill = [&](const std::pair<std::string, std::string>& pair) {
+    std::string text = pattern;
+    for(size_t at = text.find('%'); at != std::string::npos; at = text.find('%', at)) {
+      text.replace(at, 2, text[at + 1] == 'a' ? pair.first : pair.second);
+    }
+    return text;
+  };
+
+  size_t total = 0;
+  Clock::time_point start = Clock::now();
+  for(auto& pair: names) {
+    total += Query(fill(pair)).run(pool).size();
+  }
+  double chained = elapsed(start);
+
+  size_t separate_total = 0;
+  start = Clock::now();
+  for(auto& pair: names) {
+    separate_total += separate(pair.first, pair.second).size();
+  }
+  double one_by_one = elapsed(start);
+
+  std::cout << label << chained / names.size() << " us/query vs " << one_by_one / names.size()
+            << " us/query a hop at a time (" << double(total) / names.size() << " people per answer)\n";
+  return total == separate_total;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int queries     = argc > 3 ? std::atoi(argv[3]) : 2000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+
+  std::mt19937 rng(12345);
+  std::vector<std::pair<std::string, std::string>> names;
+  for(int i = 0; i < queries; ++i) {
+    int a = between(rng, 0, people - 1);
+    int b = std::min(people - 1, a + between(rng, 0, 2 * people / generations - 1));
+    names.emplace_back("P" + std::to_string(a), "P" + std::to_string(b));
+  }
+
+  auto intersect = [](const std::vector<PersonID>& a, const std::vector<PersonID>& b) {
+    std::vector<PersonID> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+  };
+  auto unite = [](const std::vector<PersonID>& a, const std::vector<PersonID>& b) {
+    std::vector<PersonID> result;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+  };
+
+  std::cout << "people:                  " << people << " in " << generations << " generations, spread " << spread << "\n";
+  bool same = true;
+
+  same &= compare(pool, "cousins' children:       ", "%a's maternal cousins' children", [&](const std::string& a, const std::string&) {
+    return hop(pool, ask(pool, a + "'s maternal cousins"), "children");
+  }, names);
+
+  same &= compare(pool, "grandparents' grandsons: ", "%a's grandparents' grandsons' sons", [&](const std::string& a, const std::string&) {
+    return hop(pool, hop(pool, ask(pool, a + "'s grandparents"), "grandsons"), "sons");
+  }, names);
+
+  same &= compare(pool, "shared cousins:          ", "%a's cousins' sons | %a's cousins' daughters", [&](const std::string& a, const std::string&) {
+    std::vector<PersonID> cousins = ask(pool, a + "'s cousins");
+    return unite(hop(pool, cousins, "sons"), hop(pool, cousins, "daughters"));
+  }, names);
+
+  same &= compare(pool, "common descendants:      ", "%a's descendants & %b's descendants", [&](const std::string& a, const std::string& b) {
+    return intersect(ask(pool, a + "'s descendants"), ask(pool, b + "'s descendants"));
+  }, names);
+
+  pool.buildClosureIndex();
+  same &= compare(pool, "same, with the index:    ", "%a's descendants & %b's descendants", [&](const std::string& a, const std::string& b) {
+    return intersect(ask(pool, a + "'s descendants"), ask(pool, b + "'s descendants"));
+  }, names);
+
+  same &= compare(pool, "cousins - descendants:   ", "%b's cousins - %a's descendants", [&](const std::string& a, const std::string& b) {
+    std::vector<PersonID> cousins = ask(pool, b + "'s cousins");
+    std::vector<PersonID> descendants = ask(pool, a + "'s descendants");
+    std::vector<PersonID> result;
+    std::set_difference(cousins.begin(), cousins.end(), descendants.begin(), descendants.end(), std::back_inserter(result));
+    return result;
+  }, names);
+
+  if(!same) {
+    std::cerr << "Mismatch between chained and separate queries!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Benchmark: Relatedness over a whole pool and over a cohort, checked
+// against the textbook recursion.
+//
+// The recursion is Wright's: a person's kinship with themselves is half of
+// one plus their parents' kinship, and otherwise the kinship of a and b is
+// the average of b's kinship with a's parents, taking a as the later-born.
+// It is memoized, but it still touches every pair of ancestors it meets, so
+// it only checks a sample.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./relatedness_bench [people] [generations] [cohort] [spread] [budget MiB]
+
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Recursion {
+  const PersonStore& store;
+  const std::vector<uint32_t>& generations;
+  std::unordered_map<uint64_t, double> memo;
+
+  double kinship(PersonID a, PersonID b) {
+    if(a == NO_PERSON || b == NO_PERSON) return 0.0;
+    if(generations[a] < generations[b] || (generations[a] == generations[b] && a < b)) std::swap(a, b);
+
+    uint64_t key = uint64_t(a) << 32 | b;
+    auto found = memo.find(key);
+    if(found != memo.end()) return found->second;
+
+    double result = a == b
+      ? (1.0 + kinship(store.mother(a), store.father(a))) / 2
+      : (kinship(store.mother(a), b) + kinship(store.father(a), b)) / 2;
+    memo[key] = result;
+    return result;
+  }
+};
+
+// A tiny pedigree with known answers:
+static bool known() {
+  std::istringstream stream(
+    "Gran\tfemale\t???\t???\n"
+    "Gramps\tmale\t???\t???\n"
+    "Ann\tfemale\tGran\tGramps\n"
+    "Bob\tmale\tGran\tGramps\n"
+    "Cat\tfemale\t???\t???\n"
+    "Dan\tmale\t???\t???\n"
+    "Eve\tfemale\tAnn\tDan\n"
+    "Fred\tmale\tCat\tBob\n"
+    "Gil\tmale\tAnn\tBob\n");
+  GenePool pool(stream);
+  auto near = [](double a, double b) { return std::fabs(a - b) < 1e-12; };
+  return near(pool.relatedness(pool.find("Ann"), pool.find("Bob")), 0.5)
+      && near(pool.relatedness(pool.find("Eve"), pool.find("Fred")), 0.125)
+      && near(pool.relatedness(pool.find("Gran"), pool.find("Ann")), 0.5)
+      && near(pool.inbreeding(pool.find("Gil")), 0.25)
+      && near(pool.inbreeding(pool.find("Eve")), 0.0)
+      && pool.relatedness(pool.find("Cat"), pool.find("Dan")) == 0.0;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int cohort      = argc > 3 ? std::atoi(argv[3]) : 2000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+  size_t budget   = (argc > 5 ? std::atoi(argv[5]) : 256) * size_t(1 << 20);
+
+  if(!known()) {
+    std::cerr << "Wrong coefficients for the known pedigree!\n";
+    return 1;
+  }
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+  const PersonStore& store = pool.store();
+  const std::vector<uint32_t>& depths = pool.generations();
+
+  Clock::time_point start = Clock::now();
+  Relatedness everyone(store, depths);
+  double built = elapsed(start);
+
+  double total = 0.0;
+  size_t inbred = 0;
+  for(PersonID id = 0; id < store.size(); ++id) {
+    total += everyone.inbreeding(id);
+    inbred += everyone.inbreeding(id) > 0.0;
+  }
+
+  // A cohort from the youngest generations, as a breeding programme would pick:
+  int per_generation = std::max(2, people / generations);
+  std::mt19937 rng(12345);
+  std::vector<PersonID> chosen;
+  for(int i = 0; i < cohort; ++i) chosen.push_back(between(rng, std::max(0, people - 3 * per_generation), people - 1));
+  std::sort(chosen.begin(), chosen.end());
+  chosen.erase(std::unique(chosen.begin(), chosen.end()), chosen.end());
+
+  start = Clock::now();
+  Relatedness subset(store, depths, chosen.data(), chosen.data() + chosen.size());
+  double covered = elapsed(start);
+
+  start = Clock::now();
+  std::vector<double> matrix = subset.matrix(chosen.data(), chosen.data() + chosen.size(), budget);
+  double filled = elapsed(start);
+
+  // Check a sample of both against the recursion:
+  Recursion recursion{store, depths, {}};
+  size_t mismatches = 0;
+  auto member = [&]() { return between(rng, size_t(0), chosen.size() - 1); };
+  start = Clock::now();
+  const int checks = 50;
+  for(int i = 0; i < checks; ++i) {
+    size_t a = member();
+    size_t b = member();
+    double expected = recursion.kinship(chosen[a], chosen[b]);
+    double single = everyone.kinship(chosen[a], chosen[b]);
+    double blocked = matrix[a * chosen.size() + b];
+    double f = recursion.kinship(store.mother(chosen[a]), store.father(chosen[a]));
+    if(std::fabs(expected - single) > 1e-9 || std::fabs(expected - blocked) > 1e-9
+    || std::fabs(f - everyone.inbreeding(chosen[a])) > 1e-9 || std::fabs(f - subset.inbreeding(chosen[a])) > 1e-9) {
+      if(mismatches++ < 5) {
+        std::cerr << store.name(chosen[a]) << " / " << store.name(chosen[b]) << ": " << single << " and "
+                  << blocked << " vs " << expected << "\n";
+      }
+    }
+  }
+  double recursed = elapsed(start);
+
+  start = Clock::now();
+  for(int i = 0; i < 200; ++i) {
+    everyone.kinship(chosen[member()], chosen[member()]);
+  }
+  double single = elapsed(start);
+
+  std::cout << "people:        " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "inbreeding:    " << built / 1000 << " ms for everyone, " << everyone.bytes() / 1048576.0 << " MiB ("
+            << 100.0 * inbred / store.size() << "% inbred, mean F " << total / store.size() << ")\n";
+  std::cout << "one kinship:   " << single / 200 << " us/pair over the whole pool\n";
+  std::cout << "cohort:        " << chosen.size() << " people, " << subset.people().size() << " with ancestors, "
+            << covered / 1000 << " ms\n";
+  std::cout << "matrix:        " << filled / 1000 << " ms for " << chosen.size() * chosen.size() << " kinships under "
+            << budget / 1048576 << " MiB (" << 1000.0 * filled / (chosen.size() * chosen.size()) << " ns each)\n";
+  std::cout << "recursion:     " << recursed / checks << " us/pair, memoized\n";
+
+  if(mismatches != 0) {
+    std::cerr << mismatches << " mismatches against the recursion!\n";
+    return 1;
+  }
+  return 0;
+}
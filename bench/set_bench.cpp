@@ -0,0 +1,99 @@
+// Benchmark: set algebra on large results, PersonSet versus sorted ID vectors.
+//
+// Founders' descendants are most of the pool, so their sets are bitsets;
+// later generations' are smaller and stay sorted arrays. Each pair of
+// people is combined both ways and the answers are checked against each
+// other.
+//
+// Build from the repository root with make bench (with CXXFLAGS="-O2 -mavx2"
+// for the AVX2 kernels).
+// Run:
+//   ./set_bench [people] [generations] [pairs] [spread]
+
+#include "family.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int pairs       = argc > 3 ? std::atoi(argv[3]) : 200;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 8;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+  GenePool pool(text.data(), text.size());
+  people = static_cast<int>(pool.store().size());
+
+  // People from the first few generations, whose descendants are large:
+  int per_generation = std::max(2, people / generations);
+  std::mt19937 rng(12345);
+  int early = std::min(people, 4 * per_generation);
+
+  std::vector<PersonSet> sets;
+  std::vector<std::vector<PersonID>> vectors;
+  size_t dense = 0;
+  size_t members = 0;
+  Clock::time_point start = Clock::now();
+  for(int i = 0; i < 2 * pairs; ++i) {
+    sets.push_back(pool.person(static_cast<PersonID>(between(rng, 0, early - 1)))->descendants());
+  }
+  double walks = elapsed(start);
+
+  for(const PersonSet& set: sets) {
+    vectors.emplace_back();
+    set.ids(vectors.back());
+    dense += set.dense();
+    members += set.size();
+  }
+
+  const char* labels[] = {"union:        ", "intersection: ", "difference:   "};
+  std::cout << "people:        " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "descendants:   " << walks / sets.size() << " us each (" << double(members) / sets.size()
+            << " people, " << dense << " of " << sets.size() << " dense)\n";
+
+  bool same = true;
+  for(int op = 0; op < 3; ++op) {
+    size_t total = 0;
+    start = Clock::now();
+    for(int i = 0; i < pairs; ++i) {
+      PersonSet result = sets[2 * i];
+      if(op == 0) result.merge(sets[2 * i + 1]);
+      if(op == 1) result.intersect(sets[2 * i + 1]);
+      if(op == 2) result.subtract(sets[2 * i + 1]);
+      total += result.size();
+    }
+    double adaptive = elapsed(start);
+
+    size_t vector_total = 0;
+    start = Clock::now();
+    for(int i = 0; i < pairs; ++i) {
+      const std::vector<PersonID>& a = vectors[2 * i];
+      const std::vector<PersonID>& b = vectors[2 * i + 1];
+      std::vector<PersonID> result;
+      if(op == 0) std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+      if(op == 1) std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+      if(op == 2) std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+      vector_total += result.size();
+    }
+    double sorted = elapsed(start);
+
+    std::cout << labels[op] << adaptive / pairs << " us vs " << sorted / pairs << " us with sorted vectors ("
+              << double(total) / pairs << " people)\n";
+    same &= total == vector_total;
+  }
+
+  if(!same) {
+    std::cerr << "Mismatch between PersonSet and sorted vectors!\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,261 @@
+// Benchmark suite: load time, memory per person, and the latency of every
+// Person function and every query form, on a synthetic pedigree.
+//
+// The pedigree comes from bench/pedigree.h, so a run is reproducible from
+// its options alone. Results are printed as TSV for regression tracking:
+// a header, then one row per measurement (metric, value, unit, and the
+// average answer size for latencies). Lines starting with '#' record the
+// options. Latencies are the fastest of --repeat passes over the same
+// sample of people, which steadies them against noise.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./suite_bench [--people N] [--generations N] [--fertility F] [--spread N]
+//                 [--half-siblings P] [--remarriage P] [--collapse P] [--seed N]
+//                 [--samples N] [--repeat N] [--write pedigree.tsv]
+// With --write, the pedigree is saved as a data file and nothing is timed.
+
+#include "Parsing.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Resident memory of the process, in bytes (0 where /proc is missing):
+static size_t resident() {
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0;
+  size_t rss = 0;
+  if(!(statm >> pages >> rss)) return 0;
+  return rss * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static void row(const std::string& metric, double value, const char* unit, double answer = -1) {
+  std::cout << metric << '\t' << value << '\t' << unit << '\t';
+  if(answer < 0) std::cout << '-';
+  else std::cout << answer;
+  std::cout << '\n';
+}
+
+// Run one call per sample, repeat times; returns the fastest pass's mean
+// in ns and sets answer to the mean answer size.
+template <typename Call>
+static double measure(size_t samples, int repeat, double& answer, Call call) {
+  double best = 0;
+  for(int pass = 0; pass < repeat; ++pass) {
+    size_t total = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < samples; ++i) total += call(i);
+    double took = elapsed(start) * 1000 / std::max<size_t>(samples, 1);
+    if(pass == 0 || took < best) best = took;
+    answer = static_cast<double>(total) / std::max<size_t>(samples, 1);
+  }
+  return best;
+}
+
+int main(int argc, char** argv) {
+  PedigreeOptions options;
+  size_t samples = 2000;
+  int repeat = 3;
+  const char* write = nullptr;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if(value == nullptr) {
+      std::cerr << "Missing value for " << arg << "\n";
+      return 1;
+    }
+    ++i;
+    if(arg == "--people") options.people = std::atoi(value);
+    else if(arg == "--generations") options.generations = std::atoi(value);
+    else if(arg == "--fertility") options.fertility = std::atof(value);
+    else if(arg == "--spread") options.spread = std::atoi(value);
+    else if(arg == "--half-siblings") options.halfSiblings = std::atof(value);
+    else if(arg == "--remarriage") options.remarriage = std::atof(value);
+    else if(arg == "--collapse") options.collapse = std::atof(value);
+    else if(arg == "--seed") options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if(arg == "--samples") samples = std::strtoul(value, nullptr, 10);
+    else if(arg == "--repeat") repeat = std::max(1, std::atoi(value));
+    else if(arg == "--write") write = value;
+    else {
+      std::cerr << "Unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  Clock::time_point start = Clock::now();
+  std::string text = PedigreeGenerator(options).tsv();
+  double generated = elapsed(start);
+
+  if(write != nullptr) {
+    std::ofstream out(write, std::ios::binary);
+    out << text;
+    std::cerr << "Wrote " << std::count(text.begin(), text.end(), '\n') << " people to " << write << "\n";
+    return out ? 0 : 1;
+  }
+
+  std::cout << "# people\t" << options.people << "\n# generations\t" << options.generations
+            << "\n# fertility\t" << options.fertility << "\n# spread\t" << options.spread
+            << "\n# half-siblings\t" << options.halfSiblings << "\n# remarriage\t" << options.remarriage
+            << "\n# collapse\t" << options.collapse << "\n# seed\t" << options.seed
+            << "\n# samples\t" << samples << "\n# repeat\t" << repeat << "\n";
+  std::cout << "metric\tvalue\tunit\tanswer\n";
+
+  // Loading, and what the pool costs to keep:
+  size_t before = resident();
+  start = Clock::now();
+  std::unique_ptr<GenePool> pool(new GenePool(text.data(), text.size()));
+  double loaded = elapsed(start);
+  pool->everyone().size();  // Make the person pages, as queries would
+  size_t after = resident();
+
+  size_t people = pool->store().size();
+  double megabytes = text.size() / (1024.0 * 1024.0);
+  row("generate", generated / 1000, "ms");
+  row("people", static_cast<double>(people), "people");
+  row("load", loaded / 1000, "ms");
+  row("load.rate", megabytes / (loaded / 1e6), "MB/s");
+  row("memory", after > before ? double(after - before) / std::max<size_t>(people, 1) : 0, "bytes/person");
+
+  // The pool's own account of it, by part (bench/memory_bench.cpp covers
+  // compact() and edits):
+  MemoryUsage memory = pool->memoryUsage();
+  double per = static_cast<double>(std::max<size_t>(people, 1));
+  row("heap", memory.total() / per, "bytes/person");
+  row("heap.names", memory.names / per, "bytes/person");
+  row("heap.links", memory.links / per, "bytes/person");
+  row("heap.adjacency", memory.adjacency / per, "bytes/person");
+  row("heap.indexes", memory.indexes / per, "bytes/person");
+  row("heap.caches", memory.caches / per, "bytes/person");
+
+  // The same sample of people for everything, with a second person from the
+  // same family nearby for the two-person forms:
+  std::mt19937 rng(options.seed);
+  std::vector<std::string> names;
+  std::vector<std::string> others;
+  std::vector<Person*> sample;
+  for(size_t i = 0; i < samples; ++i) {
+    size_t id = between(rng, size_t(0), people - 1);
+    size_t other = std::min(people - 1, size_t(std::max<long>(0, long(id) + between(rng, -50, 50))));
+    names.push_back("P" + std::to_string(id));
+    others.push_back("P" + std::to_string(other));
+    sample.push_back(pool->find(names.back()));
+  }
+
+  double answer = 0;
+  double ns = measure(samples, repeat, answer, [&](size_t i) { return pool->find(names[i]) != nullptr; });
+  row("find", ns, "ns", answer);
+
+  // Every Person function, with defaults, then with a modifier where taken:
+  typedef std::function<size_t(Person*)> Call;
+  const std::vector<std::pair<std::string, Call>> FUNCTIONS = {
+    {"name",                      [](Person* p) { return p->name().size(); }},
+    {"gender",                    [](Person* p) { return size_t(p->gender() == Gender::MALE); }},
+    {"mother",                    [](Person* p) { return size_t(p->mother() != nullptr); }},
+    {"father",                    [](Person* p) { return size_t(p->father() != nullptr); }},
+    {"ancestors",                 [](Person* p) { return p->ancestors().size(); }},
+    {"ancestors(maternal)",       [](Person* p) { return p->ancestors(PMod::MATERNAL).size(); }},
+    {"aunts",                     [](Person* p) { return p->aunts().size(); }},
+    {"aunts(paternal,half)",      [](Person* p) { return p->aunts(PMod::PATERNAL, SMod::HALF).size(); }},
+    {"brothers",                  [](Person* p) { return p->brothers().size(); }},
+    {"brothers(any,full)",        [](Person* p) { return p->brothers(PMod::ANY, SMod::FULL).size(); }},
+    {"children",                  [](Person* p) { return p->children().size(); }},
+    {"cousins",                   [](Person* p) { return p->cousins().size(); }},
+    {"cousins(maternal,full)",    [](Person* p) { return p->cousins(PMod::MATERNAL, SMod::FULL).size(); }},
+    {"daughters",                 [](Person* p) { return p->daughters().size(); }},
+    {"descendants",               [](Person* p) { return p->descendants().size(); }},
+    {"grandchildren",             [](Person* p) { return p->grandchildren().size(); }},
+    {"granddaughters",            [](Person* p) { return p->granddaughters().size(); }},
+    {"grandfathers",              [](Person* p) { return p->grandfathers().size(); }},
+    {"grandfathers(maternal)",    [](Person* p) { return p->grandfathers(PMod::MATERNAL).size(); }},
+    {"grandmothers",              [](Person* p) { return p->grandmothers().size(); }},
+    {"grandmothers(paternal)",    [](Person* p) { return p->grandmothers(PMod::PATERNAL).size(); }},
+    {"grandparents",              [](Person* p) { return p->grandparents().size(); }},
+    {"grandparents(maternal)",    [](Person* p) { return p->grandparents(PMod::MATERNAL).size(); }},
+    {"grandsons",                 [](Person* p) { return p->grandsons().size(); }},
+    {"nephews",                   [](Person* p) { return p->nephews().size(); }},
+    {"nephews(maternal,half)",    [](Person* p) { return p->nephews(PMod::MATERNAL, SMod::HALF).size(); }},
+    {"nieces",                    [](Person* p) { return p->nieces().size(); }},
+    {"nieces(any,full)",          [](Person* p) { return p->nieces(PMod::ANY, SMod::FULL).size(); }},
+    {"parents",                   [](Person* p) { return p->parents().size(); }},
+    {"parents(paternal)",         [](Person* p) { return p->parents(PMod::PATERNAL).size(); }},
+    {"siblings",                  [](Person* p) { return p->siblings().size(); }},
+    {"siblings(any,half)",        [](Person* p) { return p->siblings(PMod::ANY, SMod::HALF).size(); }},
+    {"sisters",                   [](Person* p) { return p->sisters().size(); }},
+    {"sisters(maternal,full)",    [](Person* p) { return p->sisters(PMod::MATERNAL, SMod::FULL).size(); }},
+    {"sons",                      [](Person* p) { return p->sons().size(); }},
+    {"uncles",                    [](Person* p) { return p->uncles().size(); }},
+    {"uncles(maternal,any)",      [](Person* p) { return p->uncles(PMod::MATERNAL, SMod::ANY).size(); }},
+  };
+  for(const auto& function: FUNCTIONS) {
+    ns = measure(samples, repeat, answer, [&](size_t i) { return function.second(sample[i]); });
+    row("person." + function.first, ns, "ns", answer);
+  }
+
+  // Every query form, X and Y standing for two people of one family. The
+  // queries are parsed beforehand, and parsing is timed on its own.
+  const std::vector<std::string> FORMS = {
+    "X's parents", "X's mother", "X's father", "X's children", "X's sons", "X's daughters",
+    "X's siblings", "X's brothers", "X's sisters", "X's grandparents", "X's grandmothers",
+    "X's grandfathers", "X's grandchildren", "X's grandsons", "X's granddaughters",
+    "X's aunts", "X's uncles", "X's nephews", "X's nieces", "X's cousins",
+    "X's ancestors", "X's descendants",
+    "X's maternal grandparents", "X's paternal half siblings", "X's maternal full cousins",
+    "X's mother's sisters", "X's cousins' sons", "X's grandparents' grandchildren",
+    "X's descendants & Y's descendants", "X's children | Y's children",
+    "X's cousins - Y's descendants", "(X's children | Y's children) - X's grandchildren",
+    "How is X related to Y?",
+  };
+  auto instance = [&](const std::string& form, size_t i) {
+    std::string text = form;
+    for(size_t at; (at = text.find('X')) != std::string::npos;) text.replace(at, 1, names[i]);
+    for(size_t at; (at = text.find('Y')) != std::string::npos;) text.replace(at, 1, others[i]);
+    return text;
+  };
+
+  std::vector<std::string> texts;
+  for(const std::string& form: FORMS) {
+    if(KinshipQuery::matches(form)) continue;
+    for(size_t i = 0; i < samples; ++i) texts.push_back(instance(form, i));
+  }
+  ns = measure(texts.size(), repeat, answer, [&](size_t i) { return Query(texts[i]).to_string().size(); });
+  row("query.parse", ns, "ns");
+
+  for(const std::string& form: FORMS) {
+    if(KinshipQuery::matches(form)) {
+      std::vector<KinshipQuery> parsed;
+      for(size_t i = 0; i < samples; ++i) parsed.emplace_back(instance(form, i));
+      ns = measure(samples, repeat, answer, [&](size_t i) { return parsed[i].run(*pool).size(); });
+      row("query." + form, ns, "ns");
+      continue;
+    }
+    std::vector<Query> parsed;
+    for(size_t i = 0; i < samples; ++i) parsed.emplace_back(instance(form, i));
+    ns = measure(samples, repeat, answer, [&](size_t i) { return parsed[i].run(*pool).size(); });
+    row("query." + form, ns, "ns", answer);
+  }
+
+  // Population-wide forms take time in the whole pool, so a few runs do:
+  const std::vector<std::string> WIDE = {"everyone's mother", "everyone - X's descendants"};
+  size_t few = std::min<size_t>(samples, 10);
+  for(const std::string& form: WIDE) {
+    std::vector<Query> parsed;
+    for(size_t i = 0; i < few; ++i) parsed.emplace_back(instance(form, i));
+    ns = measure(few, repeat, answer, [&](size_t i) { return parsed[i].run(*pool).size(); });
+    row("query." + form, ns / 1000, "us", answer);
+  }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+// Benchmark: applying a change log to a loaded pool versus reloading it.
+//
+// Random edits (mostly new people, some new parents, a few removals) are
+// appended to a change log, then followed by the loaded pool. The edited
+// pool is checked against a fresh load of the same family: everyone's
+// parents, children, generation and some query answers must agree, before
+// and after a snapshot round trip.
+//
+// Build from the repository root with make bench.
+// Run:
+//   ./update_bench [people] [generations] [edits] [spread]
+
+#include "ChangeLog.h"
+#include "Parsing.h"
+#include "Snapshot.h"
+#include "bench/bench.h"
+#include "bench/pedigree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Everyone still in the pool, as a data file (names are unique here):
+static std::string dump(const GenePool& pool) {
+  const PersonStore& store = pool.store();
+  auto name = [&](PersonID id) {
+    return id == NO_PERSON ? std::string("???") : std::string(store.name(id));
+  };
+
+  std::ostringstream tsv;
+  for(Person* person: pool.everyone()) {
+    PersonID id = person->id();
+    tsv << name(id) << '\t' << (store.gender(id) == Gender::MALE ? "male" : "female") << '\t'
+        << name(store.mother(id)) << '\t' << name(store.father(id)) << '\n';
+  }
+  return tsv.str();
+}
+
+// Compare two pools person by person, by name:
+static size_t differences(const GenePool& edited, const GenePool& fresh) {
+  const PersonStore& a = edited.store();
+  const PersonStore& b = fresh.store();
+  std::vector<uint32_t> depthsA = KinshipSolver::generations(a);
+  const std::vector<uint32_t>& kept = edited.generations();
+
+  auto names = [](const PersonStore& store, IDRange ids) {
+    std::vector<std::string> result;
+    for(PersonID id: ids) result.emplace_back(store.name(id));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto name = [](const PersonStore& store, PersonID id) {
+    return id == NO_PERSON ? std::string("???") : std::string(store.name(id));
+  };
+
+  size_t count = 0;
+  for(Person* person: fresh.everyone()) {
+    PersonID theirs = person->id();
+    Person* mine = edited.find(person->name());
+    bool same = mine != nullptr;
+    if(same) {
+      PersonID id = mine->id();
+      same = name(a, a.mother(id)) == name(b, b.mother(theirs))
+          && name(a, a.father(id)) == name(b, b.father(theirs))
+          && names(a, a.children(id)) == names(b, b.children(theirs))
+          && kept[id] == depthsA[id];
+    }
+    if(!same && count++ < 5) {
+      std::cerr << "Mismatch at " << person->name() << "\n";
+    }
+  }
+  return count + (edited.everyone().size() != fresh.everyone().size());
+}
+
+static size_t answers(const GenePool& edited, const GenePool& fresh, const std::vector<std::string>& names) {
+  static const char* const QUERIES[] = {"'s cousins", "'s descendants", "'s siblings", "'s grandparents"};
+  size_t count = 0;
+  for(const std::string& name: names) {
+    if(edited.find(name) == nullptr) continue;
+    for(const char* query: QUERIES) {
+      std::vector<std::string> mine;
+      std::vector<std::string> theirs;
+      for(Person* person: Query(name + query).run(edited)) mine.emplace_back(person->name());
+      for(Person* person: Query(name + query).run(fresh)) theirs.emplace_back(person->name());
+      std::sort(mine.begin(), mine.end());
+      std::sort(theirs.begin(), theirs.end());
+      if(mine != theirs && count++ < 5) {
+        std::cerr << "Different answers to " << name << query << "\n";
+      }
+    }
+  }
+  return count;
+}
+
+int main(int argc, char** argv) {
+  int people      = argc > 1 ? std::atoi(argv[1]) : 200000;
+  int generations = argc > 2 ? std::atoi(argv[2]) : 40;
+  int edits       = argc > 3 ? std::atoi(argv[3]) : 20000;
+  int spread      = argc > 4 ? std::atoi(argv[4]) : 2;
+
+  std::string text = PedigreeGenerator(plainPedigree(people, generations, spread)).tsv();
+
+  Clock::time_point start = Clock::now();
+  std::unique_ptr<GenePool> pool(new GenePool(text.data(), text.size()));
+  double loaded = elapsed(start);
+  pool->generations();  // So edits keep them up to date
+  people = static_cast<int>(pool->store().size());
+  std::mt19937 rng(12345);
+
+  // Every parent link runs from a lower ID to a higher one, which keeps the
+  // edits acyclic. New people get the next IDs, as they will in the pool.
+  const std::string path = "update_bench.changes.tsv";
+  std::remove(path.c_str());
+  ChangeLog log(path);
+
+  std::vector<std::string> names;
+  std::vector<Gender> genders;
+  std::vector<bool> gone;
+  for(int i = 0; i < people; ++i) {
+    names.push_back("P" + std::to_string(i));
+    genders.push_back(pool->store().gender(i));
+    gone.push_back(false);
+  }
+  auto pick = [&](size_t below, Gender gender) {
+    // Someone still present of the given gender, or ???
+    for(int tries = 0; tries < 8 && below > 2; ++tries) {
+      size_t low = below > 4 * size_t(people / generations) ? below - 4 * size_t(people / generations) : 0;
+      size_t id = between(rng, low, below - 1);
+      if(genders[id] == gender && !gone[id]) return names[id];
+    }
+    return std::string("???");
+  };
+
+  int added = 0;
+  for(int e = 0; e < edits; ++e) {
+    int k = between(rng, 0, 9);
+    size_t count = names.size();
+    if(k < 6) {
+      Gender gender = count % 2 == 0 ? Gender::MALE : Gender::FEMALE;
+      log.add("N" + std::to_string(added++), gender, pick(count, Gender::FEMALE), pick(count, Gender::MALE));
+      names.push_back("N" + std::to_string(added - 1));
+      genders.push_back(gender);
+      gone.push_back(false);
+    }
+    else {
+      size_t id = between(rng, count / 2, count - 1);
+      if(gone[id]) continue;
+      if(k < 9) {
+        log.parents(names[id], pick(id, Gender::FEMALE), pick(id, Gender::MALE));
+      }
+      else {
+        log.remove(names[id]);
+        gone[id] = true;
+      }
+    }
+  }
+
+  start = Clock::now();
+  size_t applied = log.follow(*pool);
+  double followed = elapsed(start);
+
+  std::string edited = dump(*pool);
+  start = Clock::now();
+  GenePool fresh(edited.data(), edited.size(), LoadMode::ANY_ORDER);
+  double reloaded = elapsed(start);
+
+  std::vector<std::string> sample;
+  for(int i = 0; i < 500; ++i) {
+    sample.push_back(names[between(rng, size_t(0), names.size() - 1)]);
+  }
+
+  size_t wrong = differences(*pool, fresh) + answers(*pool, fresh, sample);
+
+  // Snapshots pack the moved children lists:
+  const char* snapshot = "update_bench.snapshot.bin";
+  pool->save(snapshot);
+  pool.reset();
+  auto file = std::make_shared<MappedFile>(snapshot);
+  GenePool reopened(file);
+  wrong += differences(reopened, fresh) + answers(reopened, fresh, sample);
+  std::remove(snapshot);
+  std::remove(path.c_str());
+
+  std::cout << "people:        " << people << " in " << generations << " generations, spread " << spread << "\n";
+  std::cout << "load:          " << loaded / 1000 << " ms\n";
+  std::cout << "change log:    " << applied << " edits in " << followed / 1000 << " ms ("
+            << followed / std::max<size_t>(applied, 1) << " us/edit, generations kept up to date)\n";
+  std::cout << "reload:        " << reloaded / 1000 << " ms for the edited family\n";
+
+  if(wrong != 0) {
+    std::cerr << wrong << " differences between the edited pool and a fresh load!\n";
+    return 1;
+  }
+  return 0;
+}
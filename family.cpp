@@ -1,54 +1,476 @@
-
 #include "family.h"
 // family Member Functions
-#include <sstream>
+#include "Parallel.h"
+#include "Snapshot.h"
+#include "Traversal.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 // Destructor
-GenePool::~GenePool() {
-    for (auto& pair : m_people) {
-        delete pair.second;
-    }
+GenePool::~GenePool() = default;
+
+// Constructor
+GenePool::GenePool(std::istream& stream, LoadMode mode) : m_index(m_store) {
+    std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    load(text.data(), text.size(), mode);
+}
+
+// Constructor
+GenePool::GenePool(const char* data, size_t size, LoadMode mode) : m_index(m_store) {
+    load(data, size, mode);
 }
 
 // Constructor
-GenePool::GenePool(std::istream& stream) {
-    std::string line;
-    while (std::getline(stream, line)) {
-        if (line.empty() || line[0] == '#') continue;
+GenePool::GenePool(const std::vector<std::string_view>& shards, LoadMode mode) : m_index(m_store) {
+    ingest(shards, mode, m_store, m_index);
+    makePages();
+}
+
+// Constructor
+GenePool::GenePool(std::shared_ptr<const MappedFile> snapshot, bool verify) : m_index(m_store) {
+    m_mapped = snapshot->size();
+    openSnapshot(std::move(snapshot), m_store, m_index, m_lca, verify);
+    makePages();
+}
+
+// Parse the rows on all cores
+void GenePool::load(const char* data, size_t size, LoadMode mode) {
+    ingest(data, size, mode, m_store, m_index);
+    makePages();
+}
 
-        std::istringstream ss(line);
-        std::string name, gender, motherName, fatherName;
-        std::getline(ss, name, '\t');
-        std::getline(ss, gender, '\t');
-        std::getline(ss, motherName, '\t');
-        std::getline(ss, fatherName, '\t');
+// Set up the page table for the Person views, keeping any pages already made
+void GenePool::makePages() {
+    static_assert(std::is_trivially_destructible<Person>::value, "Person views live in the arena");
+    size_t count = (m_store.size() + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (m_pages && count <= m_pageCount) return;
 
-        addPerson(name, gender == "male" ? Gender::MALE : Gender::FEMALE, motherName, fatherName);
+    // Edits add people one at a time, so leave room to grow
+    if (m_pages) count = std::max(count, 2 * m_pageCount);
+    std::unique_ptr<std::atomic<Person*>[]> pages(new std::atomic<Person*>[count]);
+    for (size_t page = 0; page < count; ++page) {
+        pages[page].store(page < m_pageCount ? m_pages[page].load() : nullptr);
     }
+    m_pages = std::move(pages);
+    m_pageCount = count;
 }
 
-// Adding a person into the family tree data base / Updating information
-void GenePool::addPerson(const std::string& name, Gender gender, const std::string& motherName, const std::string& fatherName) {
-    Person* mother = (motherName != "???") ? find(motherName) : nullptr;
-    Person* father = (fatherName != "???") ? find(fatherName) : nullptr;
-    Person* person = new Person(name, gender, mother, father);
-    m_people[name] = person;
+/*
+Make the views for one page of IDs in room carved from the arena. Threads
+that ask for the same page at once wait on the lock, and all but the first
+find it made. Pages are always whole, so people added later on the last
+page already have views.
+*/
+Person* GenePool::makePage(size_t page) const {
+    std::lock_guard<std::mutex> lock(m_arenaLock);
+    Person* people = m_pages[page].load(std::memory_order_acquire);
+    if (people == nullptr) {
+        people = m_arena.allocate<Person>(PAGE_SIZE);
+        size_t first = page * PAGE_SIZE;
+        for (size_t i = 0; i < PAGE_SIZE; ++i) {
+            new (people + i) Person(this, static_cast<PersonID>(first + i));
+        }
+        m_pages[page].store(people, std::memory_order_release);
+    }
+    return people;
+}
+
+/*
+Number people so that families share pages: generation by generation, and
+within a generation by their parents' places, so siblings sit together,
+next to their cousins, below their parents. Someone with no parents goes
+right after the partner they had their first child with, in that partner's
+generation; founders with founder partners and childless founders go last
+in the first generation, partners together.
+*/
+static std::vector<PersonID> familyOrder(const PersonStore& store, const std::vector<uint32_t>& generations) {
+    size_t count = store.size();
+    auto founder = [&](PersonID id) {
+        return store.mother(id) == NO_PERSON && store.father(id) == NO_PERSON;
+    };
+    auto partner = [&](PersonID id) {
+        IDRange children = store.children(id);
+        if (children.empty()) return NO_PERSON;
+        PersonID mother = store.mother(children[0]);
+        return mother == id ? store.father(children[0]) : mother;
+    };
+
+    // Bucket everyone by the generation they are placed in
+    std::vector<uint32_t> layerOf(count);
+    std::vector<size_t> starts(1, 0);
+    for (PersonID id = 0; id < count; ++id) {
+        PersonID other = founder(id) ? partner(id) : NO_PERSON;
+        layerOf[id] = other != NO_PERSON && !founder(other) ? generations[other] : generations[id];
+        if (layerOf[id] + 2 > starts.size()) starts.resize(layerOf[id] + 2, 0);
+        ++starts[layerOf[id] + 1];
+    }
+    for (size_t l = 1; l < starts.size(); ++l) {
+        starts[l] += starts[l - 1];
+    }
+    std::vector<PersonID> layers(count);
+    std::vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (PersonID id = 0; id < count; ++id) {
+        layers[next[layerOf[id]]++] = id;
+    }
+
+    // Then order each generation with the one above it already placed
+    std::vector<PersonID> order;
+    order.reserve(count);
+    std::vector<uint32_t> position(count, NO_PERSON);
+    std::vector<std::tuple<uint64_t, PersonID, PersonID>> keys;
+    auto place = [&](PersonID id) { return id == NO_PERSON ? uint64_t(NO_PERSON) : uint64_t(position[id]); };
+
+    for (size_t l = 0; l + 1 < starts.size(); ++l) {
+        keys.clear();
+        for (size_t i = starts[l]; i < starts[l + 1]; ++i) {
+            PersonID id = layers[i];
+            if (!founder(id)) keys.emplace_back(place(store.mother(id)) << 32 | place(store.father(id)), id, id);
+        }
+        std::sort(keys.begin(), keys.end());
+        for (size_t k = 0; k < keys.size(); ++k) {
+            position[std::get<2>(keys[k])] = static_cast<uint32_t>(order.size() + k);
+        }
 
-    if (mother) mother->m_children.insert(person);
-    if (father) father->m_children.insert(person);
+        // Children sorted, founders slot in after their partners
+        for (auto& key : keys) {
+            std::get<0>(key) = uint64_t(position[std::get<2>(key)]) << 1;
+        }
+        for (size_t i = starts[l]; i < starts[l + 1]; ++i) {
+            PersonID id = layers[i];
+            if (!founder(id)) continue;
+            PersonID other = partner(id);
+            if (other != NO_PERSON && !founder(other) && layerOf[other] == l) {
+                keys.emplace_back(uint64_t(position[other]) << 1 | 1, other, id);
+            }
+            else {
+                IDRange children = store.children(id);
+                keys.emplace_back(UINT64_MAX, children.empty() ? NO_PERSON : children[0], id);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        for (const auto& key : keys) {
+            position[std::get<2>(key)] = static_cast<uint32_t>(order.size());
+            order.push_back(std::get<2>(key));
+        }
+    }
+    return order;
 }
 
-// Listing everyone in the database/Tree
-std::set<Person*> GenePool::everyone() const {
-    std::set<Person*> result;
-    for (const auto& pair : m_people) {
-        result.insert(pair.second);
+// Save a snapshot of the store, with a perfect hash of the names and the LCA index
+void GenePool::save(const char* path, PersonOrder order) {
+    if (!m_store.packed()) m_store.buildChildren();
+    if (order == PersonOrder::LOADED) {
+        saveSnapshot(m_store, m_index.perfect(), m_lca.get(), path);
+        return;
+    }
+
+    std::vector<PersonID> ids = familyOrder(m_store, generations());
+    std::vector<PersonID> renamed(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        renamed[ids[i]] = static_cast<PersonID>(i);
     }
+
+    // Only people the index finds keep their names findable
+    PersonStore store = m_store.reordered(ids);
+    NameIndex names(store);
+    m_index.each([&](PersonID id) {
+        names.insert(store.name(renamed[id]), renamed[id]);
+    });
+    std::unique_ptr<LCAIndex> lca(m_lca ? new LCAIndex(store) : nullptr);
+    saveSnapshot(store, names.perfect(), lca.get(), path);
+}
+
+// Listing everyone in the database/Tree
+PersonSet GenePool::everyone() const {
+    std::vector<PersonID> ids;
+    m_index.each([&](PersonID id) {
+        ids.push_back(id);
+    });
+
+    PersonSet result(this);
+    result.insert(ids.data(), ids.data() + ids.size());
     return result;
 }
 
 // Locate the person in the database/family Tree 
-Person* GenePool::find(const std::string& name) const {
-    auto it = m_people.find(name);
-    return it != m_people.end() ? it->second : nullptr;
-}
\ No newline at end of file
+Person* GenePool::find(std::string_view name) const {
+    return person(m_index.find(name));
+}
+
+// Edits
+Person* GenePool::add(std::string_view name, Gender gender, const Person* mother, const Person* father) {
+    if (name.empty() || name == "???" || name.find_first_of("\t\n\r") != std::string_view::npos || name[0] == '#') {
+        throw std::runtime_error("Not a usable name: \"" + std::string(name) + "\"");
+    }
+
+    PersonID id = m_store.add(name, gender);
+    makePages();
+    m_index.insert(m_store.name(id), id);
+    if (m_generationsReady) m_generations.push_back(0);
+
+    relink(id, mother ? mother->id() : NO_PERSON, father ? father->id() : NO_PERSON);
+    return person(id);
+}
+
+/*
+A new parent must not descend from the child. Descendants are in later
+generations than the child, so the search up from the parent only needs
+ancestors later than the child too: usually there are none to look at.
+*/
+void GenePool::setParents(const Person* child, const Person* mother, const Person* father) {
+    const std::vector<uint32_t>& depths = generations();
+    PersonID id = child->id();
+
+    // Only people below the child can descend from them
+    auto descends = [&](PersonID from) {
+        if (from == id) return true;
+        if (m_closure) return m_closure->is_ancestor(id, from);
+        if (depths[from] <= depths[id]) return false;
+        return Traversal::local().searchUp(m_store, from,
+            [&](PersonID next) { return next == id; },
+            [&](PersonID next) { return depths[next] <= depths[id]; });
+    };
+
+    for (const Person* parent : {mother, father}) {
+        if (parent && descends(parent->id())) {
+            throw std::runtime_error(std::string(child->name()) + " cannot be a child of their own descendant " + std::string(parent->name()) + ".");
+        }
+    }
+    relink(child->id(), mother ? mother->id() : NO_PERSON, father ? father->id() : NO_PERSON);
+}
+
+void GenePool::remove(const Person* gone) {
+    PersonID id = gone->id();
+    m_index.erase(m_store.name(id), id);
+
+    std::vector<PersonID> children(m_store.children(id).begin(), m_store.children(id).end());
+    for (PersonID child : children) {
+        PersonID mother = m_store.mother(child);
+        PersonID father = m_store.father(child);
+        relink(child, mother == id ? NO_PERSON : mother, father == id ? NO_PERSON : father);
+    }
+    relink(id, NO_PERSON, NO_PERSON);
+}
+
+/*
+Change the links, drop the indexes that cannot follow, and bring the
+generations below id up to date: each person's only depends on their
+parents', so only people whose generation changed pass it on.
+*/
+void GenePool::relink(PersonID id, PersonID mother, PersonID father) {
+    if (m_store.mother(id) != mother || m_store.father(id) != father) {
+        if (m_cache) {
+            const PersonID touched[] = {id, m_store.mother(id), m_store.father(id), mother, father};
+            m_cache->invalidate(m_store, std::begin(touched), std::end(touched));
+        }
+        m_store.link(id, mother, father);
+        m_closure.reset();
+        m_lca.reset();
+    }
+    if (!m_generationsReady) return;
+
+    std::vector<PersonID> stack(1, id);
+    while (!stack.empty()) {
+        PersonID next = stack.back();
+        stack.pop_back();
+
+        uint32_t generation = 0;
+        for (PersonID parent : {m_store.mother(next), m_store.father(next)}) {
+            if (parent != NO_PERSON) generation = std::max(generation, m_generations[parent] + 1);
+        }
+        if (generation == m_generations[next] && next != id) continue;
+
+        m_generations[next] = generation;
+        for (PersonID child : m_store.children(next)) {
+            stack.push_back(child);
+        }
+    }
+}
+
+// Build the optional ancestor/descendant index
+void GenePool::buildClosureIndex() {
+    m_closure.reset(new ClosureIndex(m_store));
+}
+
+void GenePool::buildLCAIndex() {
+    m_lca.reset(new LCAIndex(m_store));
+}
+
+void GenePool::enableCache(size_t bytes) {
+    m_cache.reset(new RelationshipCache(bytes));
+}
+
+// Memory
+MemoryUsage GenePool::memoryUsage() const {
+    MemoryUsage usage;
+    usage.names = m_store.bytes(PersonStore::NAME_OFFSETS) + m_store.bytes(PersonStore::NAME_CHARS);
+    usage.links = m_store.bytes(PersonStore::GENDERS) + m_store.bytes(PersonStore::MOTHERS) + m_store.bytes(PersonStore::FATHERS);
+    usage.adjacency = m_store.bytes(PersonStore::CHILD_OFFSETS) + m_store.bytes(PersonStore::CHILD_IDS) + m_store.movedBytes();
+
+    usage.indexes = m_index.bytes();
+    if (m_closure) usage.indexes += m_closure->bytes();
+    if (m_lca) usage.indexes += m_lca->bytes();
+
+    usage.caches = m_generations.capacity() * sizeof(uint32_t) + m_pageCount * sizeof(std::atomic<Person*>);
+    if (m_cache) usage.caches += m_cache->bytes();
+    {
+        std::lock_guard<std::mutex> lock(m_arenaLock);
+        usage.caches += m_arena.bytes();
+    }
+
+    usage.mapped = m_mapped;
+    return usage;
+}
+
+void GenePool::compact() {
+    m_store.shrink();
+    if (m_index.probing()) m_index = m_index.perfect();
+    if (m_generationsReady) m_generations.shrink_to_fit();
+}
+
+/*
+Expand part of a frontier step by step, then sort and de-duplicate each
+person's results in place. The expander keeps results grouped by person,
+in frontier order.
+*/
+static void expandPart(const GenePool& pool, const Plan& plan, const PersonID* first, const PersonID* last, Expansion& part) {
+    FrontierExpander& expander = FrontierExpander::local();
+    expander.run(pool, plan, first, last);
+
+    const std::vector<uint32_t>& owners = expander.owners();
+    part.ids = expander.ids();
+    part.offsets.assign(last - first + 1, 0);
+
+    size_t kept = 0;
+    for (size_t k = 0; k < owners.size();) {
+        size_t end = k;
+        while (end < owners.size() && owners[end] == owners[k]) ++end;
+
+        // Groups are mostly a handful of people, so insertion sort those.
+        PersonID* group = part.ids.data() + k;
+        size_t count = end - k;
+        if (count > 16) {
+            std::sort(group, group + count);
+        }
+        else {
+            for (size_t i = 1; i < count; ++i) {
+                PersonID id = group[i];
+                size_t j = i;
+                for (; j > 0 && group[j - 1] > id; --j) group[j] = group[j - 1];
+                group[j] = id;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (i == 0 || group[i] != group[i - 1]) part.ids[kept++] = group[i];
+        }
+        part.offsets[owners[k] + 1] = static_cast<uint32_t>(kept);
+        k = end;
+    }
+    part.ids.resize(kept);
+
+    // People with no results end where the last one before them did:
+    for (size_t i = 1; i < part.offsets.size(); ++i) {
+        part.offsets[i] = std::max(part.offsets[i], part.offsets[i - 1]);
+    }
+}
+
+// Expand large frontiers in parts on all cores, then join the parts.
+Expansion GenePool::expand(const PersonID* first, const PersonID* last, Relationship relationship, PMod pmod, SMod smod) const {
+    const size_t GRAIN = 1 << 14;
+    Plan plan = Plan::compile(relationship, pmod, smod);
+    size_t count = last - first;
+    size_t parts = std::max<size_t>(1, std::min<size_t>(workerCount(), count / GRAIN));
+    size_t size  = (count + parts - 1) / std::max<size_t>(parts, 1);
+
+    std::vector<Expansion> results(parts);
+    parallelFor(parts, 1, [&](size_t lo, size_t hi) {
+        for (size_t p = lo; p < hi; ++p) {
+            const PersonID* begin = first + std::min(count, p * size);
+            const PersonID* end   = first + std::min(count, (p + 1) * size);
+            expandPart(*this, plan, begin, end, results[p]);
+        }
+    });
+    if (parts == 1) return std::move(results[0]);
+
+    Expansion result;
+    result.offsets.push_back(0);
+    for (const Expansion& part : results) {
+        uint32_t base = static_cast<uint32_t>(result.ids.size());
+        for (size_t i = 1; i < part.offsets.size(); ++i) {
+            result.offsets.push_back(base + part.offsets[i]);
+        }
+        result.ids.insert(result.ids.end(), part.ids.begin(), part.ids.end());
+    }
+    return result;
+}
+
+// Work out generations the first time
+const std::vector<uint32_t>& GenePool::generations() const {
+    std::call_once(m_generationsOnce, [this] {
+        m_generations = KinshipSolver::generations(m_store);
+        m_generationsReady = true;
+    });
+    return m_generations;
+}
+
+// Name a relationship
+Kinship GenePool::relationship(const Person* a, const Person* b) const {
+    return KinshipSolver::local().solve(m_store, generations(), a->id(), b->id());
+}
+
+// Wright's coefficients, over just the people's ancestors
+double GenePool::inbreeding(const Person* person) const {
+    PersonID id = person->id();
+    return Relatedness(m_store, generations(), &id, &id + 1).inbreeding(id);
+}
+
+double GenePool::relatedness(const Person* a, const Person* b) const {
+    PersonID ids[] = {a->id(), b->id()};
+    return Relatedness(m_store, generations(), ids, ids + 2).relationship(ids[0], ids[1]);
+}
+
+/*
+Without the index, list both lines from the bottom up. Lines that meet
+share everyone from there to the top, so compare them from the top down.
+*/
+Person* GenePool::commonAncestor(const Person* a, const Person* b, PMod line) const {
+    if (m_lca) {
+        return person(m_lca->common(a->id(), b->id(), line));
+    }
+
+    auto lineage = [&](PersonID id) {
+        std::vector<PersonID> result;
+        for (; id != NO_PERSON; id = line == PMod::PATERNAL ? m_store.father(id) : m_store.mother(id)) {
+            result.push_back(id);
+        }
+        return result;
+    };
+    std::vector<PersonID> mine = lineage(a->id());
+    std::vector<PersonID> theirs = lineage(b->id());
+
+    PersonID result = NO_PERSON;
+    auto i = mine.rbegin();
+    auto j = theirs.rbegin();
+    for (; i != mine.rend() && j != theirs.rend() && *i == *j; ++i, ++j) {
+        result = *i;
+    }
+    return person(result);
+}
+
+// Check ancestry, walking the parent links when there is no index
+bool GenePool::isAncestor(const Person* a, const Person* b) const {
+    if (m_closure) {
+        return m_closure->is_ancestor(a->id(), b->id());
+    }
+
+    const std::vector<PersonID>& ancestors = Traversal::local().ancestors(m_store, b->id());
+    return std::find(ancestors.begin(), ancestors.end(), a->id()) != ancestors.end();
+}
@@ -1,32 +1,191 @@
 #ifndef FAMILY_H
 #define FAMILY_H
 
+#include "Arena.h"
+#include "ClosureIndex.h"
+#include "Frontier.h"
+#include "Kinship.h"
+#include "LCAIndex.h"
+#include "Loading.h"
+#include "NameIndex.h"
 #include "Person.h"
+#include "PersonSet.h"
+#include "PersonStore.h"
+#include "Relatedness.h"
+#include "RelationshipCache.h"
+#include "Snapshot.h"
+#include <atomic>
+#include <cstddef>
 #include <istream>
-#include <set>
-#include <string>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// What a pool holds, in bytes, by what it is for (see memoryUsage()).
+struct MemoryUsage {
+  size_t names     = 0;  // Name characters and their offsets
+  size_t links     = 0;  // Genders and parent links
+  size_t adjacency = 0;  // Children lists, moved ones included
+  size_t indexes   = 0;  // Name index, closure index and LCA index
+  size_t caches    = 0;  // Answer cache, generations and Person views
+  size_t mapped    = 0;  // A snapshot the pool runs on: mapped, not heap
+
+  size_t total() const { return names + links + adjacency + indexes + caches; }
+};
 
 class GenePool {
   // Member Variables
-  std::map<std::string, Person*> m_people;
+  PersonStore m_store;
+  NameIndex   m_index;  // Compares against the store's names
+  std::unique_ptr<ClosureIndex> m_closure;
+  std::unique_ptr<LCAIndex>     m_lca;
+  std::unique_ptr<RelationshipCache> m_cache;
+
+  // Everyone's generation, for relationship() and generations(); worked
+  // out on first use.
+  mutable std::once_flag        m_generationsOnce;
+  mutable std::vector<uint32_t> m_generations;
+  mutable bool                  m_generationsReady = false;
+
+  // Person views are made on first use, a page at a time, so opening a
+  // large pool does not touch every person. Each page is carved from the
+  // arena when it is made, so only pages in use take memory, and all of
+  // them go with the arena.
+  static const size_t PAGE_SIZE = 1024;
+  mutable std::mutex m_arenaLock;
+  mutable Arena m_arena;
+  mutable std::unique_ptr<std::atomic<Person*>[]> m_pages;  // Null until made
+  size_t m_pageCount = 0;
+
+  size_t m_mapped = 0;  // Size of the snapshot opened, if any
 
   // Helper Functions
-  void addPerson(const std::string& name, Gender gender, const std::string& motherName, const std::string& fatherName);
+  void load(const char* data, size_t size, LoadMode mode);
+  void makePages();
+  Person* makePage(size_t page) const;
+  void relink(PersonID id, PersonID mother, PersonID father);
 
 public:
   // Build a database of people from a TSV file.
-  GenePool(std::istream& stream);
+  GenePool(std::istream& stream, LoadMode mode = LoadMode::IN_ORDER);
+
+  // Build a database of people from TSV text in memory, such as a MappedFile.
+  // Names are copied out, so the buffer can be released afterwards.
+  GenePool(const char* data, size_t size, LoadMode mode = LoadMode::IN_ORDER);
 
-  // Clean it up.
+  // The same from several buffers read as one file, such as the shards of a
+  // data set in ANY_ORDER mode.
+  GenePool(const std::vector<std::string_view>& shards, LoadMode mode = LoadMode::IN_ORDER);
+
+  // Open a binary snapshot written by save(). The file stays mapped and the
+  // pool runs on it in place; verify also checks every section's checksum.
+  GenePool(std::shared_ptr<const MappedFile> snapshot, bool verify = false);
+
+  // People hold a pointer back to their pool.
+  GenePool(const GenePool& other) = delete;
+  GenePool& operator = (const GenePool& other) = delete;
+
+  // Clean it up. Person views need no destructors, so the arena just
+  // frees its blocks.
   ~GenePool();
 
   // List all the people in the database.
-  std::set<Person*> everyone() const;
+  PersonSet everyone() const;
 
   // Find a person in the database by name.
   // Return nullptr if there is no such person.
-  Person* find(const std::string& name) const;
+  Person* find(std::string_view name) const;
+
+  // Write the pool (and its LCA index, if built) as a binary snapshot.
+  // Packs the children lists first if edits have moved any. In FAMILIES
+  // order people get new IDs, so families share pages on disk; that takes
+  // a second copy of the store while saving.
+  void save(const char* path, PersonOrder order = PersonOrder::LOADED);
+
+  // Edits to a loaded pool, without a reload. Each updates the name index,
+  // the children lists and the generations in place, in time proportional
+  // to the families involved. The closure and LCA indexes are dropped (they
+  // are whole-pool labelings), so rebuild them when convenient; queries
+  // walk the parent links until then. The answer cache, if enabled, only
+  // drops the answers the edit could change.
+  //
+  // Edits need the pool to themselves: no query may run during one, and
+  // PersonSets from before an edit should not be used after it. Adding a
+  // name already in the pool shadows the earlier person, as a later row of
+  // a data file does. A removed person keeps their ID but loses their name,
+  // parents and children. Throws std::runtime_error if a name is not
+  // usable in a data file or new parents would make someone their own
+  // ancestor.
+  Person* add(std::string_view name, Gender gender, const Person* mother = nullptr, const Person* father = nullptr);
+  void setParents(const Person* person, const Person* mother, const Person* father);
+  void remove(const Person* person);
+
+  // One relationship (anything but EVERYONE) for everyone in [first, last)
+  // at once. Much faster than asking person by person for large frontiers,
+  // such as population-wide reports.
+  Expansion expand(const PersonID* first, const PersonID* last, Relationship relationship, PMod pmod = PMod::ANY, SMod smod = SMod::ANY) const;
+
+  // Is a an ancestor of b? Uses the closure index if it has been built.
+  bool isAncestor(const Person* a, const Person* b) const;
+
+  // How b is related to a, named by to_string(kinship, b's gender). Takes
+  // time in how far apart they are, not in the size of the pool.
+  Kinship relationship(const Person* a, const Person* b) const;
+
+  // Wright's inbreeding coefficient of a person, and coefficient of
+  // relationship between two people, over just their ancestors. For many
+  // people at once, build one Relatedness over them with generations().
+  double inbreeding(const Person* person) const;
+  double relatedness(const Person* a, const Person* b) const;
+
+  // Everyone's generation (see KinshipSolver::generations()).
+  const std::vector<uint32_t>& generations() const;
+
+  // The nearest common ancestor of a and b along one parent line (MATERNAL:
+  // mothers' mothers, PATERNAL: fathers' fathers), maybe a or b, or nullptr.
+  // O(log depth) with the LCA index, otherwise a walk up both lines.
+  Person* commonAncestor(const Person* a, const Person* b, PMod line) const;
+
+  // Optional index for commonAncestor(). Build it once loading is done;
+  // snapshots saved afterwards carry it. Returns nullptr until then.
+  void buildLCAIndex();
+  const LCAIndex* lca() const { return m_lca.get(); }
+
+  // Optional index for O(1) ancestry checks and fast closure enumeration.
+  // Build it once loading is done; returns nullptr until then.
+  void buildClosureIndex();
+  const ClosureIndex* closure() const { return m_closure.get(); }
+
+  // Optional cache of one person's answers, for queries that are asked
+  // again and again. Edits keep it exact. Returns nullptr until enabled.
+  void enableCache(size_t bytes);
+  RelationshipCache* cache() const { return m_cache.get(); }
+
+  // Heap bytes in use, from the capacity of every array the pool and its
+  // indexes hold. Sections of a snapshot are counted under mapped until an
+  // edit copies them to the heap.
+  MemoryUsage memoryUsage() const;
+
+  // Give back memory the pool can do without: pack moved children lists,
+  // trim the spare capacity edits leave, and swap the name index's probing
+  // table for a minimal perfect hash (a third of the size, and as fast to
+  // search). Later edits still work, but the first one to add a name builds
+  // a probing table again. Needs the pool to itself, as edits do.
+  void compact();
+
+  // Direct access to the underlying storage.
+  const PersonStore& store() const { return m_store; }
+  Person* person(PersonID id) const {
+    if (id == NO_PERSON) return nullptr;
+    Person* page = m_pages[id / PAGE_SIZE].load(std::memory_order_acquire);
+    return (page ? page : makePage(id / PAGE_SIZE)) + id % PAGE_SIZE;
+  }
 };
 
+// Person sets hold IDs; their iterators look the people up in the pool.
+inline Person* PersonSet::const_iterator::operator * () const {
+  return m_pool->person(id());
+}
+
 #endif
@@ -1,11 +1,25 @@
+#include "ChangeLog.h"
 #include "Person.h"
 #include "family.h"
+#include "Loading.h"
+#include "Parallel.h"
 #include "Parsing.h"
+#include "Snapshot.h"
+#include "Tracing.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -17,63 +31,371 @@ struct Compare {
 };
 
 
+// Run one line of input and return what to print for it:
+std::string answer(const GenePool& pool, const std::string& line) {
+  std::string output;
+  try {
+    // Relationship questions get a sentence rather than a list:
+    if(KinshipQuery::matches(line)) {
+      return KinshipQuery(line).run(pool);
+    }
+
+    // Parse and run the query:
+    Query query(line);
+    PersonSet result = query.run(pool);
+
+    // Make sure everyone is valid:
+    if(result.count(nullptr) != 0) {
+      throw std::runtime_error("Result set contained a null pointer.");
+    }
+
+    // Sort the people by name for consistent output:
+    std::vector<Person*> people(result.begin(), result.end());
+    std::sort(people.begin(), people.end(), Compare());
+
+    // Format the result:
+    for(Person* person: people) {
+      output += " - ";
+      output += person->name();
+      output += '\n';
+    }
+    if(people.empty()) {
+      output += " (no results)\n";
+    }
+  }
+  catch(const std::exception& e) {
+    // Report the error message:
+    output += e.what();
+    output += '\n';
+  }
+
+  return output;
+}
+
+
+// Write the trace histograms to path, replacing the file in one step so
+// that whoever watches it never reads half a report. Stats are written
+// often, so a failure is reported on stderr the first time only:
+void writeStats(const std::string& path) {
+  static bool reported = false;
+  std::string temporary = path + ".tmp";
+  bool written;
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    Trace::dump(out);
+    out.close();
+    written = !out.fail();
+  }
+  if(written && std::rename(temporary.c_str(), path.c_str()) == 0) return;
+
+  std::remove(temporary.c_str());
+  if(!reported) {
+    std::cerr << "Cannot write stats file: " << path << '\n';
+    reported = true;
+  }
+}
+
+
+// Answer every line of input on all cores, printing the answers in input
+// order (without prompts), then report throughput on stderr. Queries run a
+// block at a time so that only one block's output is held in memory. Given
+// a stats path, the trace histograms are written there after each block.
+void batch(const GenePool& pool, std::istream& input, std::ostream& output, const char* stats) {
+  const size_t BLOCK = 1 << 16;
+
+  std::vector<std::string> lines;
+  std::string line;
+  while(std::getline(input, line)) {
+    lines.push_back(line);
+  }
+
+  std::vector<float> latencies(lines.size());
+  std::vector<std::string> answers;
+  auto start = std::chrono::steady_clock::now();
+
+  for(size_t first = 0; first < lines.size(); first += BLOCK) {
+    size_t count = std::min(BLOCK, lines.size() - first);
+    answers.assign(count, std::string());
+
+    parallelForDynamic(count, 16, [&](size_t lo, size_t hi) {
+      for(size_t i = lo; i < hi; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        answers[i] = answer(pool, lines[first + i]);
+        std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+        latencies[first + i] = elapsed.count();
+      }
+    });
+
+    for(const std::string& text: answers) {
+      output << text;
+    }
+    if(stats != nullptr) {
+      writeStats(stats);
+    }
+  }
+
+  output.flush();
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+  // Percentiles of per-query latency:
+  auto percentile = [&](double p) {
+    if(latencies.empty()) return 0.0f;
+    auto nth = latencies.begin() + static_cast<size_t>(p * (latencies.size() - 1));
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return *nth;
+  };
+
+  std::cerr << "Answered " << lines.size() << " queries in " << seconds.count() * 1000
+            << " ms on " << workerCount() << " threads (" << lines.size() / seconds.count()
+            << " queries/s, p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) << " us)\n";
+}
+
+
+// Apply everything new in the change log, reporting (and skipping) lines
+// that cannot be applied:
+size_t catchUp(GenePool& pool, ChangeLog& log, std::ostream& errors) {
+  size_t before = log.edits();
+  while(true) {
+    try {
+      log.follow(pool);
+      return log.edits() - before;
+    }
+    catch(const std::exception& e) {
+      errors << "Error applying changes: " << e.what() << '\n';
+    }
+  }
+}
+
+
 int main(int argc, char** argv) {
-  if(argc != 2) {
-    std::cerr << "USAGE: ./genepool [datafile.tsv]\n";
+  std::vector<const char*> datafiles;
+  bool closure_index = false;
+  bool lca_index = false;
+  bool load_stats = false;
+  LoadMode load_mode = LoadMode::IN_ORDER;
+  const char* save_snapshot = nullptr;
+  PersonOrder save_order = PersonOrder::LOADED;
+  bool verify = false;
+  bool batch_mode = false;
+  const char* changes = nullptr;
+  size_t cache_megabytes = 0;
+  const char* stats_file = nullptr;
+  bool compact = false;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if(arg == "--closure-index") {
+      closure_index = true;
+    }
+    else if(arg == "--lca-index") {
+      lca_index = true;
+    }
+    else if(arg == "--load-stats") {
+      load_stats = true;
+    }
+    else if(arg == "--any-order") {
+      load_mode = LoadMode::ANY_ORDER;
+    }
+    else if(arg == "--save-snapshot" && i + 1 < argc) {
+      save_snapshot = argv[++i];
+    }
+    else if(arg == "--family-order") {
+      save_order = PersonOrder::FAMILIES;
+    }
+    else if(arg == "--verify") {
+      verify = true;
+    }
+    else if(arg == "--batch") {
+      batch_mode = true;
+    }
+    else if(arg == "--changes" && i + 1 < argc) {
+      changes = argv[++i];
+    }
+    else if(arg == "--cache" && i + 1 < argc) {
+      // A whole number of megabytes that fits in a size_t once shifted:
+      const char* value = argv[++i];
+      char* end = nullptr;
+      errno = 0;
+      unsigned long long megabytes = std::strtoull(value, &end, 10);
+      if(!std::isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || errno == ERANGE ||
+         megabytes > (std::numeric_limits<size_t>::max() >> 20)) {
+        datafiles.clear();
+        break;
+      }
+      cache_megabytes = static_cast<size_t>(megabytes);
+    }
+    else if(arg == "--stats-file" && i + 1 < argc) {
+      stats_file = argv[++i];
+    }
+    else if(arg == "--compact") {
+      compact = true;
+    }
+    else if(arg[0] != '-') {
+      datafiles.push_back(argv[i]);
+    }
+    else {
+      datafiles.clear();
+      break;
+    }
+  }
+
+  if(datafiles.empty()) {
+    std::cerr << "USAGE: ./genepool [--closure-index] [--lca-index] [--load-stats] [--any-order] [--batch]\n"
+              << "                  [--save-snapshot snapshot.bin] [--family-order] [--verify]\n"
+              << "                  [--changes changes.tsv] [--cache megabytes] [--stats-file stats.tsv]\n"
+              << "                  [--compact]\n"
+              << "                  [datafile.tsv... | snapshot.bin]\n";
     return 1;
   }
 
   GenePool* pool = nullptr;
+  std::unique_ptr<ChangeLog> log;
 
   try {
-    // Read the database file:
-    std::ifstream stream(argv[1]);
-    if(stream.fail()) {
-      std::cout << "Error opening database file.\n";
-      return 1;
+    // Map the database files, then open one as a snapshot or parse them all
+    // as one TSV load (reading ahead only once they are known to be TSV):
+    std::vector<std::shared_ptr<MappedFile>> files;
+    size_t bytes = 0;
+    for(const char* datafile: datafiles) {
+      files.push_back(std::make_shared<MappedFile>(datafile, Access::RANDOM));
+      if(!files.back()->is_open()) {
+        std::cout << "Error opening database file.\n";
+        return 1;
+      }
+      bytes += files.back()->size();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if(isSnapshot(files[0]->data(), files[0]->size())) {
+      if(files.size() > 1) {
+        std::cout << "A snapshot must be opened on its own.\n";
+        return 1;
+      }
+      pool = new GenePool(files[0], verify);
+    }
+    else {
+      std::vector<std::string_view> shards;
+      for(const std::shared_ptr<MappedFile>& file: files) {
+        file->advise(file->data(), file->size(), Access::SEQUENTIAL);
+        shards.emplace_back(file->data(), file->size());
+      }
+      pool = new GenePool(shards, load_mode);
+      files.clear();
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    if(load_stats) {
+      double megabytes = bytes / (1024.0 * 1024.0);
+      std::cerr << "Loaded " << pool->store().size() << " people from "
+                << megabytes << " MB in " << seconds.count() * 1000 << " ms ("
+                << megabytes / seconds.count() << " MB/s)\n";
+    }
+
+    // Catch up on edits made since the data file was written:
+    if(changes != nullptr) {
+      log.reset(new ChangeLog(changes));
+      size_t edits = catchUp(*pool, *log, std::cerr);
+      if(load_stats) {
+        std::cerr << "Applied " << edits << " edits from " << changes << "\n";
+      }
+    }
+
+    if(compact) {
+      pool->compact();
     }
 
-    pool = new GenePool(stream);
+    // Snapshots carry the LCA index, so build it first:
+    if(lca_index && pool->lca() == nullptr) {
+      pool->buildLCAIndex();
+    }
+
+    if(save_snapshot != nullptr) {
+      pool->save(save_snapshot, save_order);
+    }
+
+    if(closure_index) {
+      pool->buildClosureIndex();
+    }
+
+    if(cache_megabytes != 0) {
+      pool->enableCache(cache_megabytes << 20);
+    }
+
+    if(load_stats) {
+      MemoryUsage memory = pool->memoryUsage();
+      double megabyte = 1024.0 * 1024.0;
+      std::cerr << "Memory: " << memory.total() / megabyte << " MB ("
+                << double(memory.total()) / std::max<size_t>(pool->store().size(), 1) << " bytes/person): "
+                << memory.names / megabyte << " names, " << memory.links / megabyte << " links, "
+                << memory.adjacency / megabyte << " adjacency, " << memory.indexes / megabyte << " indexes, "
+                << memory.caches / megabyte << " caches";
+      if(memory.mapped != 0) {
+        std::cerr << "; " << memory.mapped / megabyte << " MB snapshot mapped";
+      }
+      std::cerr << "\n";
+    }
   }
   catch(const std::exception& e) {
     std::cerr << "Error reading database: " << e.what() << "\n";
     return 1;
   }
 
+  if(batch_mode) {
+    batch(*pool, std::cin, std::cout, stats_file);
+    if(load_stats && pool->cache()) {
+      RelationshipCache::Stats stats = pool->cache()->stats();
+      std::cerr << "Cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+                << stats.hitRate() * 100 << "%), " << stats.entries << " answers in "
+                << stats.bytes / (1024.0 * 1024.0) << " MB, " << stats.evictions << " evicted\n";
+    }
+    delete pool;
+    return 0;
+  }
+
   std::string line;
+  auto written = std::chrono::steady_clock::now();
+  auto edited = written;
   std::cout << "> ";
   while(std::getline(std::cin, line)) {
-    try {
-      // Parse and run the query:
-      Query query(line);
-      std::set<Person*> result = query.run(*pool);
-
-      // Make sure everyone is valid:
-      if(result.count(nullptr) != 0) {
-        throw std::runtime_error("Result set contained a null pointer.");
-      }
-
-      // Sort the people by name for consistent output:
-      std::vector<Person*> people(result.begin(), result.end());
-      std::sort(people.begin(), people.end(), Compare());
-
-      // Print the result:
-      for(Person* person: people) {
-        std::cout << " - " << person->name() << std::endl;
+    // "stats" prints the trace histograms instead of running a query:
+    if(line == "stats") {
+      if(Trace::TRACING) {
+        Trace::dump(std::cout);
       }
-      if(people.empty()) {
-        std::cout << " (no results)\n";
+      else {
+        std::cout << "Tracing is off; build with -DGENEPOOL_TRACE to record it.\n";
       }
+      std::cout << "> ";
+      continue;
     }
-    catch(const std::exception& e) {
-      // Print the error message:
-      std::cout << e.what() << std::endl;
+
+    // Pick up edits appended to the change log since the last query:
+    if(log && catchUp(*pool, *log, std::cout) > 0) {
+      edited = std::chrono::steady_clock::now();
+    }
+
+    std::cout << answer(*pool, line) << std::flush;
+    std::cout << "> " << std::flush;
+
+    // Edits drop the indexes, and queries walk without them. Build them
+    // again once the log has been quiet for a second, after an answer is
+    // out rather than before one, so a stream of edits never waits on them:
+    if(log && std::chrono::steady_clock::now() - edited > std::chrono::seconds(1)) {
+      if(lca_index && pool->lca() == nullptr) pool->buildLCAIndex();
+      if(closure_index && pool->closure() == nullptr) pool->buildClosureIndex();
     }
 
-    std::cout << "> ";
+    // Rewrite the stats file now and then, not after every query:
+    if(stats_file != nullptr && std::chrono::steady_clock::now() - written > std::chrono::seconds(1)) {
+      writeStats(stats_file);
+      written = std::chrono::steady_clock::now();
+    }
   }
 
   std::cout << '\n';
+  if(stats_file != nullptr) {
+    writeStats(stats_file);
+  }
   delete pool;
   return 0;
 }